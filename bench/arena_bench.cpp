@@ -0,0 +1,112 @@
+#include "../src/MessageParser.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <vector>
+#include <sys/time.h>
+
+static size_t allocations = 0;
+
+void* operator new(size_t size) throw(std::bad_alloc) {
+    allocations++;
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) throw() {
+    std::free(ptr);
+}
+
+static double nowSeconds() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static size_t sink = 0;
+
+static void legacyHandle(const std::string& message, const std::string& prefix, size_t recipients) {
+    std::vector<std::string> tokens;
+    std::istringstream iss(message);
+    std::string token;
+    bool foundColon = false;
+    
+    while (iss >> token) {
+        if (!foundColon && token[0] == ':' && !tokens.empty()) {
+            std::string rest;
+            std::getline(iss, rest);
+            token = token.substr(1) + rest;
+            foundColon = true;
+        }
+        tokens.push_back(token);
+    }
+    
+    std::vector<std::string> params(tokens.begin() + 1, tokens.end());
+    std::istringstream targetStream(params[0]);
+    std::string target;
+    
+    while (std::getline(targetStream, target, ',')) {
+        std::string msg = ":" + prefix + " PRIVMSG " + target + " :" + params[1];
+        for (size_t i = 0; i < recipients; i++) {
+            std::string framed = msg + "\r\n";
+            sink += framed.length();
+        }
+    }
+}
+
+static void arenaHandle(const std::string& message, const std::string& prefix, size_t recipients) {
+    std::string command;
+    Params params;
+    splitMessage(message, command, params);
+    
+    std::string target;
+    size_t position = 0;
+    while (nextListItem(params[0], position, target)) {
+        ArenaString framed;
+        framed.reserve(prefix.length() + target.length() + params[1].length() + 16);
+        framed.append(":").append(prefix.data(), prefix.length()).append(" PRIVMSG ")
+              .append(target.data(), target.length()).append(" :").append(params[1].data(), params[1].length()).append("\r\n");
+        for (size_t i = 0; i < recipients; i++)
+            sink += framed.length();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t messages = argc > 1 ? strtoul(argv[1], NULL, 10) : 500000;
+    size_t recipients = 10;
+    const size_t tickBudget = 8;
+    std::string prefix = "somebody!someuser@host.example.com";
+    std::string message = "PRIVMSG #channel :hello everyone, this is a perfectly ordinary chat line of moderate length";
+    
+    Arena::tick().allocate(1);
+    Arena::tick().reset();
+    
+    size_t before = allocations;
+    double start = nowSeconds();
+    for (size_t i = 0; i < messages; i++)
+        legacyHandle(message, prefix, recipients);
+    double legacyTime = nowSeconds() - start;
+    size_t legacyAllocations = allocations - before;
+    
+    before = allocations;
+    start = nowSeconds();
+    for (size_t i = 0; i < messages; i++) {
+        arenaHandle(message, prefix, recipients);
+        if (i % tickBudget == tickBudget - 1)
+            Arena::tick().reset();
+    }
+    double arenaTime = nowSeconds() - start;
+    size_t arenaAllocations = allocations - before;
+    
+    std::cout << "messages:        " << messages << " (PRIVMSG to a channel of " << recipients << ")" << std::endl;
+    std::cout << "legacy:          " << static_cast<double>(legacyAllocations) / messages << " allocations/msg, "
+              << legacyTime / messages * 1e9 << " ns/msg" << std::endl;
+    std::cout << "arena:           " << static_cast<double>(arenaAllocations) / messages << " allocations/msg, "
+              << arenaTime / messages * 1e9 << " ns/msg" << std::endl;
+    std::cout << "arena chunks:    " << Arena::tick().getChunkCount() << ", high water "
+              << Arena::tick().getHighWater() << " bytes" << std::endl;
+    return sink == 0;
+}
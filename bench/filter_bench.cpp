@@ -0,0 +1,68 @@
+#include "../src/ContentFilter.hpp"
+
+#include <iostream>
+#include <cstdlib>
+#include <sys/time.h>
+
+static double nowSeconds() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static std::string randomWord(size_t minLength, size_t maxLength) {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz";
+    size_t length = minLength + rand() % (maxLength - minLength + 1);
+    std::string word;
+    for (size_t i = 0; i < length; i++)
+        word += alphabet[rand() % 26];
+    return word;
+}
+
+int main(int argc, char* argv[]) {
+    size_t patternCount = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000;
+    size_t messageCount = argc > 2 ? strtoul(argv[2], NULL, 10) : 200000;
+    srand(1337);
+    
+    std::vector<FilterRule> rules;
+    for (size_t i = 0; i < patternCount; i++) {
+        FilterRule rule;
+        rule.pattern = randomWord(6, 14);
+        rule.action = (i % 3 == 0) ? FILTER_BLOCK : (i % 3 == 1) ? FILTER_TAG : FILTER_LOG;
+        rule.regex = false;
+        rules.push_back(rule);
+    }
+    
+    std::vector<std::string> messages;
+    for (size_t i = 0; i < 1024; i++) {
+        std::string message;
+        while (message.length() < 400)
+            message += randomWord(2, 9) + " ";
+        messages.push_back(message);
+    }
+    
+    double start = nowSeconds();
+    FilterAutomaton automaton(rules);
+    double compiled = nowSeconds();
+    
+    size_t matches = 0;
+    size_t bytes = 0;
+    for (size_t i = 0; i < messageCount; i++) {
+        size_t rule;
+        const std::string& message = messages[i % messages.size()];
+        if (automaton.match(message, rule) != FILTER_NONE)
+            matches++;
+        bytes += message.length();
+    }
+    double finished = nowSeconds();
+    
+    double elapsed = finished - compiled;
+    std::cout << "patterns:      " << patternCount << std::endl;
+    std::cout << "states:        " << automaton.getStateCount() << std::endl;
+    std::cout << "compile:       " << (compiled - start) * 1000 << " ms" << std::endl;
+    std::cout << "messages:      " << messageCount << " (" << matches << " matched)" << std::endl;
+    std::cout << "throughput:    " << messageCount / elapsed << " msg/s, "
+              << bytes / elapsed / 1048576 << " MiB/s" << std::endl;
+    std::cout << "per message:   " << elapsed / messageCount * 1e9 << " ns" << std::endl;
+    return 0;
+}
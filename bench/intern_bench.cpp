@@ -0,0 +1,114 @@
+#include "../src/StringPool.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <vector>
+#include <sys/time.h>
+
+static size_t heapBytes = 0;
+
+void* operator new(size_t size) throw(std::bad_alloc) {
+    size_t* ptr = static_cast<size_t*>(std::malloc(size + sizeof(size_t) * 2));
+    if (!ptr)
+        throw std::bad_alloc();
+    heapBytes += size;
+    ptr[0] = size;
+    return ptr + 2;
+}
+
+void operator delete(void* ptr) throw() {
+    if (!ptr) return;
+    size_t* block = static_cast<size_t*>(ptr) - 2;
+    heapBytes -= block[0];
+    std::free(block);
+}
+
+static double nowSeconds() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+struct PlainIdentity {
+    std::string username;
+    std::string realname;
+    std::string hostname;
+};
+
+struct InternedIdentity {
+    InternedString username;
+    InternedString realname;
+    InternedString hostname;
+};
+
+static const size_t CONNECTIONS = 100000;
+static const size_t HOSTS = 1000;
+
+static std::string hostFor(size_t i) {
+    std::ostringstream oss;
+    oss << "nat-gw-" << i % HOSTS << ".dsl.customers.example-isp.net";
+    return oss.str();
+}
+
+static std::string userFor(size_t i) {
+    std::ostringstream oss;
+    oss << "~bouncer" << i % (HOSTS * 4);
+    return oss.str();
+}
+
+static std::string realFor(size_t i) {
+    std::ostringstream oss;
+    oss << "ZNC - https://znc.in user " << i % (HOSTS * 8);
+    return oss.str();
+}
+
+int main() {
+    std::vector<std::string> hosts, users, reals;
+    for (size_t i = 0; i < CONNECTIONS; i++) {
+        hosts.push_back(hostFor(i));
+        users.push_back(userFor(i));
+        reals.push_back(realFor(i));
+    }
+    
+    std::vector<PlainIdentity> plain(CONNECTIONS);
+    size_t before = heapBytes;
+    for (size_t i = 0; i < CONNECTIONS; i++) {
+        plain[i].username = users[i];
+        plain[i].realname = reals[i];
+        plain[i].hostname = hosts[i];
+    }
+    size_t plainBytes = heapBytes - before;
+    
+    std::vector<InternedIdentity> interned(CONNECTIONS);
+    before = heapBytes;
+    for (size_t i = 0; i < CONNECTIONS; i++) {
+        interned[i].username = InternedString(users[i]);
+        interned[i].realname = InternedString(reals[i]);
+        interned[i].hostname = InternedString(hosts[i]);
+    }
+    size_t internedBytes = heapBytes - before;
+    
+    size_t matches = 0;
+    double start = nowSeconds();
+    for (size_t i = 0; i < CONNECTIONS; i++)
+        for (size_t j = 0; j < 64; j++)
+            matches += plain[i].hostname == plain[(i + j * HOSTS) % CONNECTIONS].hostname;
+    double plainTime = nowSeconds() - start;
+    
+    start = nowSeconds();
+    for (size_t i = 0; i < CONNECTIONS; i++)
+        for (size_t j = 0; j < 64; j++)
+            matches += interned[i].hostname == interned[(i + j * HOSTS) % CONNECTIONS].hostname;
+    double internedTime = nowSeconds() - start;
+    
+    std::cout << CONNECTIONS << " identities from " << HOSTS << " hosts, "
+              << InternedString::poolSize() << " interned strings" << std::endl;
+    std::cout << "std::string     heap=" << plainBytes / 1024 << " KiB ("
+              << plainBytes / CONNECTIONS << " B/conn) inline=" << sizeof(PlainIdentity) << " B compare="
+              << plainTime * 1e9 / (CONNECTIONS * 64) << " ns" << std::endl;
+    std::cout << "InternedString  heap=" << internedBytes / 1024 << " KiB ("
+              << internedBytes / CONNECTIONS << " B/conn) inline=" << sizeof(InternedIdentity) << " B compare="
+              << internedTime * 1e9 / (CONNECTIONS * 64) << " ns" << std::endl;
+    return matches == 0;
+}
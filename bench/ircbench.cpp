@@ -0,0 +1,637 @@
+#include "../src/Metrics.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+enum ConnectionState {
+    STATE_IDLE = 0,
+    STATE_CONNECTING,
+    STATE_REGISTERING,
+    STATE_READY
+};
+
+enum Action {
+    ACTION_CHANNEL = 0,
+    ACTION_NICK,
+    ACTION_JOINPART,
+    ACTION_RENAME,
+    ACTION_COUNT
+};
+
+struct Connection {
+    int fd;
+    ConnectionState state;
+    std::string nick;
+    std::string channel;
+    std::string input;
+    std::string output;
+    unsigned long long connectStart;
+    unsigned long long joinStart;
+    unsigned int renames;
+
+    Connection() : fd(-1), state(STATE_IDLE), connectStart(0), joinStart(0), renames(0) {}
+};
+
+struct Options {
+    std::string host;
+    int port;
+    std::string password;
+    size_t clients;
+    size_t channels;
+    double duration;
+    double rate;
+    double connectRate;
+    size_t inflight;
+    unsigned int mix[ACTION_COUNT];
+    std::string scenario;
+    int pid;
+    std::string json;
+    size_t payload;
+};
+
+struct Results {
+    unsigned long long sent[ACTION_COUNT];
+    unsigned long long delivered;
+    unsigned long long errors;
+    unsigned long long disconnects;
+    unsigned long long timeouts;
+    unsigned long long skipped;
+    unsigned long long received;
+    Histogram latency;
+    Histogram registration;
+    Histogram join;
+};
+
+static Options options;
+static Results results;
+static std::vector<Connection> connections;
+static std::vector<size_t> ready;
+static size_t handshakes = 0;
+static int epollFd = -1;
+static volatile sig_atomic_t interrupted = 0;
+
+static void onSignal(int signum) {
+    (void)signum;
+    interrupted = 1;
+}
+
+static void usage(const char* name) {
+    std::cerr << "usage: " << name << " [options]\n"
+              << "  --host ADDR         server address (127.0.0.1)\n"
+              << "  --port N            server port (6667)\n"
+              << "  --password PW       connection password (password)\n"
+              << "  --clients N         connections to open (1000)\n"
+              << "  --channels N        channels to spread clients over (10)\n"
+              << "  --duration S        seconds of load after ramp-up (10)\n"
+              << "  --rate N            actions per second across all clients (5000)\n"
+              << "  --connect-rate N    new connections per second (2000)\n"
+              << "  --inflight N        connections allowed to be mid-registration (128)\n"
+              << "  --mix C,N,J,R       weights for channel msg, nick msg, join/part, nick change (80,15,3,2)\n"
+              << "  --scenario NAME     steady, join-storm or reconnect-storm (steady)\n"
+              << "  --payload N         message body bytes (64)\n"
+              << "  --pid PID           server pid, for cpu and rss\n"
+              << "  --json FILE         write results as json (- for stdout)\n";
+}
+
+static bool parseOptions(int argc, char* argv[]) {
+    options.host = "127.0.0.1";
+    options.port = 6667;
+    options.password = "password";
+    options.clients = 1000;
+    options.channels = 10;
+    options.duration = 10;
+    options.rate = 5000;
+    options.connectRate = 2000;
+    options.inflight = 128;
+    options.mix[ACTION_CHANNEL] = 80;
+    options.mix[ACTION_NICK] = 15;
+    options.mix[ACTION_JOINPART] = 3;
+    options.mix[ACTION_RENAME] = 2;
+    options.scenario = "steady";
+    options.pid = 0;
+    options.payload = 64;
+
+    for (int i = 1; i < argc; i++) {
+        std::string flag = argv[i];
+        if (flag == "-h" || flag == "--help" || i + 1 >= argc)
+            return false;
+        std::string value = argv[++i];
+
+        if (flag == "--host") options.host = value;
+        else if (flag == "--port") options.port = atoi(value.c_str());
+        else if (flag == "--password") options.password = value;
+        else if (flag == "--clients") options.clients = strtoul(value.c_str(), NULL, 10);
+        else if (flag == "--channels") options.channels = strtoul(value.c_str(), NULL, 10);
+        else if (flag == "--duration") options.duration = atof(value.c_str());
+        else if (flag == "--rate") options.rate = atof(value.c_str());
+        else if (flag == "--connect-rate") options.connectRate = atof(value.c_str());
+        else if (flag == "--inflight") options.inflight = strtoul(value.c_str(), NULL, 10);
+        else if (flag == "--scenario") options.scenario = value;
+        else if (flag == "--payload") options.payload = strtoul(value.c_str(), NULL, 10);
+        else if (flag == "--pid") options.pid = atoi(value.c_str());
+        else if (flag == "--json") options.json = value;
+        else if (flag == "--mix") {
+            if (sscanf(value.c_str(), "%u,%u,%u,%u", &options.mix[0], &options.mix[1],
+                       &options.mix[2], &options.mix[3]) != 4)
+                return false;
+        } else {
+            return false;
+        }
+    }
+
+    if (options.scenario != "steady" && options.scenario != "join-storm" && options.scenario != "reconnect-storm")
+        return false;
+    return options.clients > 0 && options.channels > 0 && options.inflight > 0 && options.port > 0 && options.payload < 400;
+}
+
+static std::string sizeToString(unsigned long long value) {
+    std::ostringstream oss;
+    oss << value;
+    return oss.str();
+}
+
+static void watch(size_t id, bool writable) {
+    struct epoll_event event;
+    event.events = writable ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    event.data.u64 = id;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, connections[id].fd, &event);
+}
+
+static void queue(size_t id, const std::string& line) {
+    Connection& connection = connections[id];
+    bool idle = connection.output.empty();
+    connection.output += line;
+    connection.output += "\r\n";
+    if (idle && connection.state != STATE_CONNECTING)
+        watch(id, true);
+}
+
+static void markReady(size_t id) {
+    connections[id].state = STATE_READY;
+    handshakes--;
+    ready.push_back(id);
+}
+
+static void unmarkReady(size_t id) {
+    for (size_t i = 0; i < ready.size(); i++) {
+        if (ready[i] == id) {
+            ready[i] = ready.back();
+            ready.pop_back();
+            return;
+        }
+    }
+}
+
+static bool openConnection(size_t id) {
+    Connection& connection = connections[id];
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == -1) return false;
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(options.port);
+    inet_pton(AF_INET, options.host.c_str(), &addr.sin_addr);
+
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1 && errno != EINPROGRESS) {
+        close(fd);
+        return false;
+    }
+
+    connection.fd = fd;
+    connection.state = STATE_CONNECTING;
+    handshakes++;
+    connection.input.clear();
+    connection.output.clear();
+    connection.connectStart = Metrics::nowNs();
+    connection.nick = "b" + sizeToString(id);
+    connection.renames = 0;
+    connection.channel = "#bench" + sizeToString(id % options.channels);
+
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT;
+    event.data.u64 = id;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+
+    queue(id, "PASS " + options.password);
+    queue(id, "NICK " + connection.nick);
+    queue(id, "USER bench 0 * :ircbench");
+    return true;
+}
+
+static void closeConnection(size_t id) {
+    Connection& connection = connections[id];
+    if (connection.fd == -1) return;
+
+    if (connection.state == STATE_READY)
+        unmarkReady(id);
+    else
+        handshakes--;
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, connection.fd, NULL);
+    close(connection.fd);
+    connection.fd = -1;
+    connection.state = STATE_IDLE;
+}
+
+static void flush(size_t id) {
+    Connection& connection = connections[id];
+
+    while (!connection.output.empty()) {
+        ssize_t sent = send(connection.fd, connection.output.data(), connection.output.length(), MSG_NOSIGNAL);
+        if (sent == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            results.disconnects++;
+            closeConnection(id);
+            return;
+        }
+        connection.output.erase(0, sent);
+    }
+    watch(id, false);
+}
+
+static void handleLine(size_t id, const std::string& line, unsigned long long now) {
+    Connection& connection = connections[id];
+
+    if (line.compare(0, 5, "PING ") == 0) {
+        queue(id, "PONG " + line.substr(5));
+        return;
+    }
+
+    size_t space = line.find(' ');
+    if (space == std::string::npos) return;
+    size_t next = line.find(' ', space + 1);
+    std::string command = line.substr(space + 1, next == std::string::npos ? std::string::npos : next - space - 1);
+
+    if (command == "PRIVMSG") {
+        size_t body = line.find(" :T", next);
+        if (body != std::string::npos) {
+            unsigned long long stamp = strtoull(line.c_str() + body + 3, NULL, 10);
+            if (stamp && stamp <= now)
+                results.latency.record(now - stamp);
+            results.delivered++;
+        }
+    } else if (command == "001") {
+        if (connection.state == STATE_REGISTERING) {
+            results.registration.record(now - connection.connectStart);
+            connection.joinStart = now;
+            queue(id, "JOIN " + connection.channel);
+            markReady(id);
+        }
+    } else if (command == "JOIN") {
+        if (connection.joinStart && line.compare(1, connection.nick.length() + 1, connection.nick + "!") == 0) {
+            results.join.record(now - connection.joinStart);
+            connection.joinStart = 0;
+        }
+    } else if (command == "433" || command == "401" || command == "403" || command == "404"
+               || command == "442" || command == "461") {
+        results.errors++;
+    }
+}
+
+static void receive(size_t id, unsigned long long now) {
+    Connection& connection = connections[id];
+    char buffer[65536];
+
+    for (;;) {
+        ssize_t bytesRead = recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (bytesRead == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (bytesRead <= 0) {
+            results.disconnects++;
+            closeConnection(id);
+            return;
+        }
+        connection.input.append(buffer, bytesRead);
+        results.received += bytesRead;
+    }
+
+    size_t start = 0;
+    size_t end;
+    while ((end = connection.input.find('\n', start)) != std::string::npos) {
+        size_t length = end - start;
+        if (length && connection.input[end - 1] == '\r')
+            length--;
+        handleLine(id, connection.input.substr(start, length), now);
+        if (connection.fd == -1) return;
+        start = end + 1;
+    }
+    connection.input.erase(0, start);
+}
+
+static void onEvent(size_t id, unsigned int events, unsigned long long now) {
+    Connection& connection = connections[id];
+    if (connection.fd == -1) return;
+
+    if (connection.state == STATE_CONNECTING && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(connection.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error) {
+            results.disconnects++;
+            closeConnection(id);
+            return;
+        }
+        connection.state = STATE_REGISTERING;
+    }
+
+    if (events & EPOLLIN)
+        receive(id, now);
+    if (connection.fd != -1 && (events & EPOLLOUT))
+        flush(id);
+    if (connection.fd != -1 && (events & (EPOLLERR | EPOLLHUP)) && !(events & EPOLLIN)) {
+        results.disconnects++;
+        closeConnection(id);
+    }
+}
+
+static Action pickAction() {
+    unsigned int total = 0;
+    for (size_t i = 0; i < ACTION_COUNT; i++)
+        total += options.mix[i];
+
+    unsigned int roll = total ? rand() % total : 0;
+    for (size_t i = 0; i < ACTION_COUNT; i++) {
+        if (roll < options.mix[i])
+            return static_cast<Action>(i);
+        roll -= options.mix[i];
+    }
+    return ACTION_CHANNEL;
+}
+
+static std::string stampedBody() {
+    std::string body = "T" + sizeToString(Metrics::nowNs()) + " ";
+    body.append(options.payload, 'x');
+    return body;
+}
+
+static void act(unsigned long long now) {
+    size_t id = ready[rand() % ready.size()];
+    Connection& connection = connections[id];
+    if (connection.output.length() > 65536) {
+        results.skipped++;
+        return;
+    }
+
+    Action action = pickAction();
+    switch (action) {
+    case ACTION_CHANNEL:
+        queue(id, "PRIVMSG " + connection.channel + " :" + stampedBody());
+        break;
+    case ACTION_NICK:
+        queue(id, "PRIVMSG " + connections[ready[rand() % ready.size()]].nick + " :" + stampedBody());
+        break;
+    case ACTION_JOINPART:
+        queue(id, "PART " + connection.channel);
+        connection.channel = "#bench" + sizeToString(rand() % options.channels);
+        connection.joinStart = now;
+        queue(id, "JOIN " + connection.channel);
+        break;
+    case ACTION_RENAME:
+        connection.nick = "b" + sizeToString(id) + "_" + sizeToString(++connection.renames % 100);
+        if (connection.nick.length() > 9)
+            connection.nick = "b" + sizeToString(id);
+        queue(id, "NICK " + connection.nick);
+        break;
+    default:
+        break;
+    }
+    results.sent[action]++;
+}
+
+static void joinStorm(unsigned long long now) {
+    for (size_t i = 0; i < ready.size(); i++) {
+        Connection& connection = connections[ready[i]];
+        connection.joinStart = now;
+        queue(ready[i], "JOIN #storm");
+    }
+    std::cerr << "join storm: " << ready.size() << " clients joining #storm" << std::endl;
+}
+
+static std::vector<size_t> reconnectStorm() {
+    std::vector<size_t> victims(ready);
+    for (size_t i = 0; i < victims.size(); i++) {
+        queue(victims[i], "QUIT :reconnect storm");
+        flush(victims[i]);
+        closeConnection(victims[i]);
+    }
+    std::cerr << "reconnect storm: " << victims.size() << " clients reconnecting" << std::endl;
+    return victims;
+}
+
+static void expireHandshakes(unsigned long long now) {
+    for (size_t i = 0; i < connections.size(); i++) {
+        Connection& connection = connections[i];
+        if (connection.fd == -1 || connection.state == STATE_READY)
+            continue;
+        if (now - connection.connectStart > 10000000000ULL) {
+            results.timeouts++;
+            closeConnection(i);
+        }
+    }
+}
+
+static bool readCpu(int pid, unsigned long long& ticks) {
+    std::ifstream input(("/proc/" + sizeToString(pid) + "/stat").c_str());
+    std::string content;
+    if (!std::getline(input, content)) return false;
+
+    size_t close = content.rfind(')');
+    if (close == std::string::npos) return false;
+    std::istringstream fields(content.substr(close + 2));
+    std::string field;
+    unsigned long long utime = 0;
+    unsigned long long stime = 0;
+    for (int i = 3; i <= 15 && fields >> field; i++) {
+        if (i == 14) utime = strtoull(field.c_str(), NULL, 10);
+        if (i == 15) stime = strtoull(field.c_str(), NULL, 10);
+    }
+    ticks = utime + stime;
+    return true;
+}
+
+static unsigned long readStatusKb(int pid, const std::string& key) {
+    std::ifstream input(("/proc/" + sizeToString(pid) + "/status").c_str());
+    std::string line;
+    while (std::getline(input, line))
+        if (line.compare(0, key.length(), key) == 0)
+            return strtoul(line.c_str() + key.length() + 1, NULL, 10);
+    return 0;
+}
+
+static void writeSummary(std::ostream& out, const char* name, const Histogram& histogram, unsigned long long divisor) {
+    out << "\"" << name << "\":{\"count\":" << histogram.getCount()
+        << ",\"p50\":" << histogram.percentile(0.5) / divisor
+        << ",\"p99\":" << histogram.percentile(0.99) / divisor
+        << ",\"p999\":" << histogram.percentile(0.999) / divisor
+        << ",\"max\":" << histogram.getMax() / divisor << "}";
+}
+
+static void report(std::ostream& out, double seconds, double cpuSeconds, double cpuPercent, unsigned long rss, unsigned long hwm) {
+    unsigned long long messages = results.sent[ACTION_CHANNEL] + results.sent[ACTION_NICK];
+
+    out << "{\"scenario\":\"" << options.scenario << "\",\"clients\":" << options.clients
+        << ",\"ready\":" << ready.size() << ",\"channels\":" << options.channels
+        << ",\"duration_s\":" << seconds << ",\"target_rate\":" << options.rate
+        << ",\"sent\":{\"channel\":" << results.sent[ACTION_CHANNEL] << ",\"nick\":" << results.sent[ACTION_NICK]
+        << ",\"joinpart\":" << results.sent[ACTION_JOINPART] << ",\"rename\":" << results.sent[ACTION_RENAME] << "}"
+        << ",\"messages_per_s\":" << static_cast<unsigned long long>(messages / seconds)
+        << ",\"delivered\":" << results.delivered
+        << ",\"delivered_per_s\":" << static_cast<unsigned long long>(results.delivered / seconds)
+        << ",\"errors\":" << results.errors << ",\"disconnects\":" << results.disconnects << ",\"timeouts\":" << results.timeouts
+        << ",\"skipped\":" << results.skipped
+        << ",\"received_bytes\":" << results.received
+        << ",\"received_per_client\":" << (ready.empty() ? 0 : results.received / ready.size()) << ",";
+    writeSummary(out, "latency_us", results.latency, 1000);
+    out << ",";
+    writeSummary(out, "registration_us", results.registration, 1000);
+    out << ",";
+    writeSummary(out, "join_us", results.join, 1000);
+    out << ",\"server\":{\"pid\":" << options.pid << ",\"cpu_s\":" << cpuSeconds << ",\"cpu_percent\":" << cpuPercent
+        << ",\"rss_kb\":" << rss << ",\"hwm_kb\":" << hwm << "}}" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (!parseOptions(argc, argv)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGPIPE, SIG_IGN);
+    srand(1337);
+
+    epollFd = epoll_create(1024);
+    if (epollFd == -1) {
+        perror("epoll_create");
+        return 1;
+    }
+    connections.resize(options.clients);
+
+    unsigned long long begin = Metrics::nowNs();
+    unsigned long long loadStart = 0;
+    unsigned long long loadEnd = 0;
+    unsigned long long lastTick = begin;
+    unsigned long long cpuStart = 0;
+    unsigned long long lastProgress = begin;
+    double connectBudget = 0;
+    double actionBudget = 0;
+    size_t opened = 0;
+    bool stormDone = false;
+    std::vector<size_t> reconnecting;
+
+    struct epoll_event events[1024];
+
+    while (!interrupted) {
+        int count = epoll_wait(epollFd, events, 1024, 1);
+        unsigned long long now = Metrics::nowNs();
+        for (int i = 0; i < count; i++)
+            onEvent(events[i].data.u64, events[i].events, now);
+
+        double elapsed = (now - lastTick) / 1e9;
+        lastTick = now;
+
+        connectBudget += elapsed * options.connectRate;
+        while (connectBudget >= 1 && opened < options.clients && handshakes < options.inflight) {
+            if (!openConnection(opened))
+                results.disconnects++;
+            opened++;
+            connectBudget -= 1;
+        }
+        while (connectBudget >= 1 && !reconnecting.empty() && handshakes < options.inflight) {
+            if (!openConnection(reconnecting.back()))
+                results.disconnects++;
+            reconnecting.pop_back();
+            connectBudget -= 1;
+        }
+        if (opened >= options.clients && reconnecting.empty())
+            connectBudget = 0;
+        else if (connectBudget > options.inflight)
+            connectBudget = options.inflight;
+
+        if (!loadStart && ((opened >= options.clients && ready.size() >= options.clients)
+                           || now - begin > 30000000000ULL)) {
+            loadStart = now;
+            loadEnd = now + static_cast<unsigned long long>(options.duration * 1e9);
+            results.received = 0;
+            if (options.pid)
+                readCpu(options.pid, cpuStart);
+            std::cerr << ready.size() << "/" << options.clients << " clients registered in "
+                      << (now - begin) / 1000000 << " ms" << std::endl;
+        }
+
+        if (loadStart && now < loadEnd) {
+            if (!stormDone && now >= loadStart + (loadEnd - loadStart) / 2) {
+                stormDone = true;
+                if (options.scenario == "join-storm")
+                    joinStorm(now);
+                else if (options.scenario == "reconnect-storm")
+                    reconnecting = reconnectStorm();
+            }
+
+            actionBudget += elapsed * options.rate;
+            while (actionBudget >= 1 && !ready.empty()) {
+                act(now);
+                actionBudget -= 1;
+            }
+            if (ready.empty())
+                actionBudget = 0;
+        }
+
+        if (now - lastProgress >= 1000000000ULL) {
+            lastProgress = now;
+            expireHandshakes(now);
+            std::cerr << "ready=" << ready.size() << " delivered=" << results.delivered
+                      << " p99=" << results.latency.percentile(0.99) / 1000 << "us" << std::endl;
+        }
+
+        if (loadStart && now >= loadEnd + 1000000000ULL)
+            break;
+    }
+
+    unsigned long long finish = Metrics::nowNs();
+    double seconds = loadStart ? options.duration : (finish - begin) / 1e9;
+    double cpuSeconds = 0;
+    double cpuPercent = 0;
+    unsigned long rss = 0;
+    unsigned long hwm = 0;
+    if (options.pid) {
+        unsigned long long cpuEnd = 0;
+        if (readCpu(options.pid, cpuEnd) && loadStart) {
+            cpuSeconds = static_cast<double>(cpuEnd - cpuStart) / sysconf(_SC_CLK_TCK);
+            cpuPercent = 100.0 * cpuSeconds / ((finish - loadStart) / 1e9);
+        }
+        rss = readStatusKb(options.pid, "VmRSS");
+        hwm = readStatusKb(options.pid, "VmHWM");
+    }
+
+    report(std::cout, seconds, cpuSeconds, cpuPercent, rss, hwm);
+    if (!options.json.empty() && options.json != "-") {
+        std::ofstream output(options.json.c_str());
+        report(output, seconds, cpuSeconds, cpuPercent, rss, hwm);
+    }
+
+    for (size_t i = 0; i < connections.size(); i++)
+        closeConnection(i);
+    close(epollFd);
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include "../src/Pool.hpp"
+
+#include <iostream>
+#include <memory>
+#include <cstdlib>
+#include <vector>
+#include <sys/time.h>
+
+static size_t allocations = 0;
+
+template <typename T>
+struct CountingAllocator : std::allocator<T> {
+    template <typename U>
+    struct rebind {
+        typedef CountingAllocator<U> other;
+    };
+    
+    CountingAllocator() {}
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>&) {}
+    
+    T* allocate(size_t count, const void* = 0) {
+        allocations++;
+        return std::allocator<T>::allocate(count);
+    }
+};
+
+static double nowSeconds() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static const size_t CLIENTS = 50000;
+static const size_t CHANNELS = 5000;
+static const size_t JOINS = 8;
+static const size_t ROUNDS = 20;
+static const size_t CLIENT_BYTES = 1024;
+static const size_t CHANNEL_BYTES = 512;
+
+struct HeapObjects {
+    void* allocate(size_t bytes) { allocations++; return std::malloc(bytes); }
+    void release(void* ptr) { std::free(ptr); }
+};
+
+struct PooledObjects {
+    SlabPool clients;
+    SlabPool channels;
+    
+    PooledObjects() : clients("bench-client", CLIENT_BYTES), channels("bench-channel", CHANNEL_BYTES) {}
+    void* allocate(size_t bytes) { return bytes == CLIENT_BYTES ? clients.allocate() : channels.allocate(); }
+    void release(void* ptr, size_t bytes) { if (bytes == CLIENT_BYTES) clients.deallocate(ptr); else channels.deallocate(ptr); }
+};
+
+struct Result {
+    size_t allocations;
+    double seconds;
+};
+
+static size_t mappedSlabs() {
+    size_t slabs = 0;
+    const std::vector<SlabPool*>& pools = SlabPool::getPools();
+    for (size_t i = 0; i < pools.size(); i++)
+        slabs += pools[i]->getSlabCount();
+    return slabs;
+}
+
+static size_t channelFor(size_t client, size_t round, size_t join) {
+    return (client * 7919 + round * 104729 + join * 613) % CHANNELS;
+}
+
+static void releaseObject(HeapObjects& objects, void* ptr, size_t) { objects.release(ptr); }
+static void releaseObject(PooledObjects& objects, void* ptr, size_t bytes) { objects.release(ptr, bytes); }
+
+template <typename Set, typename Objects>
+static Result churn(Objects& objects) {
+    std::vector<void*> channels(CHANNELS);
+    std::vector<void*> clients(CLIENTS);
+    std::vector<Set> members;
+    std::vector<Set> joined;
+    members.resize(CHANNELS);
+    joined.resize(CLIENTS);
+    
+    size_t before = allocations + mappedSlabs();
+    double start = nowSeconds();
+    for (size_t c = 0; c < CHANNELS; c++)
+        channels[c] = objects.allocate(CHANNEL_BYTES);
+    for (size_t round = 0; round <= ROUNDS; round++) {
+        for (size_t i = round % 5; i < CLIENTS; i += round == 0 ? 1 : 5) {
+            if (clients[i]) {
+                for (typename Set::iterator it = joined[i].begin(); it != joined[i].end(); ++it)
+                    members[reinterpret_cast<size_t>(*it)].erase(clients[i]);
+                joined[i].clear();
+                releaseObject(objects, clients[i], CLIENT_BYTES);
+            }
+            clients[i] = objects.allocate(CLIENT_BYTES);
+            for (size_t j = 0; j < JOINS; j++) {
+                size_t c = channelFor(i, round, j);
+                members[c].insert(clients[i]);
+                joined[i].insert(reinterpret_cast<void*>(c));
+            }
+        }
+    }
+    Result result;
+    result.seconds = nowSeconds() - start;
+    result.allocations = allocations + mappedSlabs() - before;
+    
+    for (size_t i = 0; i < CLIENTS; i++)
+        releaseObject(objects, clients[i], CLIENT_BYTES);
+    for (size_t c = 0; c < CHANNELS; c++)
+        releaseObject(objects, channels[c], CHANNEL_BYTES);
+    return result;
+}
+
+static void report(const char* label, const Result& result, size_t cycles) {
+    std::cout << label << static_cast<double>(result.allocations) / cycles << " malloc or mmap calls/cycle, "
+              << result.seconds / cycles * 1e9 << " ns/cycle" << std::endl;
+}
+
+typedef std::set<void*, std::less<void*>, CountingAllocator<void*> > HeapSet;
+typedef std::set<void*, std::less<void*>, PoolAllocator<void*> > PooledSet;
+
+int main() {
+    size_t cycles = CLIENTS + CLIENTS / 5 * ROUNDS;
+    
+    HeapObjects heap;
+    Result heapResult = churn<HeapSet>(heap);
+    
+    PooledObjects pooled;
+    Result pooledResult = churn<PooledSet>(pooled);
+    
+    std::cout << "churn:           " << CLIENTS << " clients over " << CHANNELS << " channels, " << JOINS
+              << " joins each, " << ROUNDS << " rounds reconnecting 1/5" << std::endl;
+    report("malloc:          ", heapResult, cycles);
+    report("slab pools:      ", pooledResult, cycles);
+    const std::vector<SlabPool*>& pools = SlabPool::getPools();
+    for (size_t i = 0; i < pools.size(); i++)
+        std::cout << "pool " << pools[i]->getName() << ": " << pools[i]->getSlabCount() << " slabs, "
+                  << pools[i]->getCapacity() << " x " << pools[i]->getObjectSize() << " B, "
+                  << pools[i]->getAllocations() << " allocations" << std::endl;
+    return heapResult.allocations == 0;
+}
@@ -0,0 +1,215 @@
+#include "AdminListener.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+void MetricsWriter::_appendNumber(unsigned long long value) {
+    char digits[24];
+    int length = snprintf(digits, sizeof(digits), "%llu", value);
+    _out.append(digits, length);
+}
+
+void MetricsWriter::_appendSeconds(unsigned long long nanoseconds) {
+    char digits[32];
+    int length = snprintf(digits, sizeof(digits), "%llu.%09llu", nanoseconds / 1000000000ULL, nanoseconds % 1000000000ULL);
+    _out.append(digits, length);
+}
+
+void MetricsWriter::_appendLabels(const char* label, const char* value, const char* quantile) {
+    if (!label && !quantile) return;
+    
+    _out += '{';
+    if (label) {
+        _out += label;
+        _out += "=\"";
+        _out += value;
+        _out += '"';
+    }
+    if (quantile) {
+        if (label) _out += ',';
+        _out += "quantile=\"";
+        _out += quantile;
+        _out += '"';
+    }
+    _out += '}';
+}
+
+void MetricsWriter::header(const char* name, const char* type, const char* help) {
+    _out += "# HELP ";
+    _out += name;
+    _out += ' ';
+    _out += help;
+    _out += "\n# TYPE ";
+    _out += name;
+    _out += ' ';
+    _out += type;
+    _out += '\n';
+}
+
+void MetricsWriter::sample(const char* name, unsigned long long value, const char* label, const char* labelValue) {
+    _out += name;
+    _appendLabels(label, labelValue, NULL);
+    _out += ' ';
+    _appendNumber(value);
+    _out += '\n';
+}
+
+void MetricsWriter::seconds(const char* name, unsigned long long nanoseconds, const char* label,
+                            const char* labelValue, const char* quantile) {
+    _out += name;
+    _appendLabels(label, labelValue, quantile);
+    _out += ' ';
+    _appendSeconds(nanoseconds);
+    _out += '\n';
+}
+
+AdminListener::AdminListener() : _fd(-1) {}
+
+AdminListener::~AdminListener() {
+    close();
+}
+
+bool AdminListener::open(const std::string& address) {
+    if (address.compare(0, 5, "unix:") == 0) {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (address.length() - 5 >= sizeof(addr.sun_path)) return false;
+        memcpy(addr.sun_path, address.c_str() + 5, address.length() - 5);
+        
+        _fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (_fd == -1) return false;
+        unlink(addr.sun_path);
+        if (bind(_fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+            close();
+            return false;
+        }
+        _unixPath = addr.sun_path;
+    } else {
+        long port = strtol(address.c_str(), NULL, 10);
+        if (port <= 0 || port > 65535) return false;
+        
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        
+        _fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (_fd == -1) return false;
+        int opt = 1;
+        setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        if (bind(_fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+            close();
+            return false;
+        }
+    }
+    
+    if (fcntl(_fd, F_SETFL, O_NONBLOCK) == -1 || listen(_fd, 16) == -1) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void AdminListener::close() {
+    for (std::map<int, Connection>::iterator it = _connections.begin(); it != _connections.end(); ++it)
+        ::close(it->first);
+    _connections.clear();
+    
+    if (_fd != -1) {
+        ::close(_fd);
+        _fd = -1;
+    }
+    if (!_unixPath.empty()) {
+        unlink(_unixPath.c_str());
+        _unixPath.clear();
+    }
+}
+
+int AdminListener::accept() {
+    int fd = ::accept(_fd, NULL, NULL);
+    if (fd == -1) return -1;
+    
+    if (_connections.size() >= MAX_CONNECTIONS || fcntl(fd, F_SETFL, O_NONBLOCK) == -1) {
+        ::close(fd);
+        return -1;
+    }
+    
+    _connections[fd].opened = time(NULL);
+    return fd;
+}
+
+AdminEvent AdminListener::read(int fd, std::string& path) {
+    Connection& connection = _connections[fd];
+    char buffer[1024];
+    
+    ssize_t bytesRead = recv(fd, buffer, sizeof(buffer), 0);
+    if (bytesRead == 0 || (bytesRead == -1 && errno != EAGAIN && errno != EWOULDBLOCK))
+        return ADMIN_DONE;
+    if (bytesRead == -1 || !connection.response.empty())
+        return ADMIN_PENDING;
+    
+    connection.request.append(buffer, bytesRead);
+    if (connection.request.find("\r\n\r\n") == std::string::npos
+        && connection.request.find("\n\n") == std::string::npos) {
+        if (connection.request.length() > MAX_REQUEST)
+            return ADMIN_DONE;
+        return ADMIN_PENDING;
+    }
+    
+    size_t space = connection.request.find(' ');
+    size_t end = space == std::string::npos ? space : connection.request.find_first_of(" \r\n", space + 1);
+    if (connection.request.compare(0, 4, "GET ") != 0 || end == std::string::npos)
+        path.clear();
+    else
+        path = connection.request.substr(space + 1, end - space - 1);
+    return ADMIN_REQUEST;
+}
+
+void AdminListener::respond(int fd, int status, const char* reason, const char* contentType, const std::string& body) {
+    Connection& connection = _connections[fd];
+    char header[192];
+    int length = snprintf(header, sizeof(header),
+                          "HTTP/1.0 %d %s\r\nContent-Type: %s\r\n"
+                          "Content-Length: %lu\r\nConnection: close\r\n\r\n",
+                          status, reason, contentType, static_cast<unsigned long>(body.length()));
+    
+    connection.response.reserve(length + body.length());
+    connection.response.assign(header, length);
+    connection.response += body;
+    connection.sent = 0;
+}
+
+AdminEvent AdminListener::write(int fd) {
+    Connection& connection = _connections[fd];
+    if (connection.response.empty()) return ADMIN_PENDING;
+    
+    ssize_t sent = send(fd, connection.response.data() + connection.sent,
+                        connection.response.length() - connection.sent, MSG_NOSIGNAL);
+    if (sent == -1)
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? ADMIN_PENDING : ADMIN_DONE;
+    
+    connection.sent += sent;
+    return connection.sent == connection.response.length() ? ADMIN_DONE : ADMIN_PENDING;
+}
+
+void AdminListener::drop(int fd) {
+    if (_connections.erase(fd))
+        ::close(fd);
+}
+
+int AdminListener::nextExpired(time_t now, time_t timeout) const {
+    for (std::map<int, Connection>::const_iterator it = _connections.begin(); it != _connections.end(); ++it)
+        if (now - it->second.opened >= timeout)
+            return it->first;
+    return -1;
+}
@@ -0,0 +1,70 @@
+#ifndef ADMINLISTENER_HPP
+#define ADMINLISTENER_HPP
+
+#include <string>
+#include <map>
+#include <ctime>
+
+class MetricsWriter {
+private:
+    std::string& _out;
+    
+    void _appendNumber(unsigned long long value);
+    void _appendSeconds(unsigned long long nanoseconds);
+    void _appendLabels(const char* label, const char* value, const char* quantile);
+    
+public:
+    explicit MetricsWriter(std::string& out) : _out(out) {}
+    
+    void header(const char* name, const char* type, const char* help);
+    void sample(const char* name, unsigned long long value, const char* label = NULL, const char* labelValue = NULL);
+    void seconds(const char* name, unsigned long long nanoseconds, const char* label = NULL,
+                 const char* labelValue = NULL, const char* quantile = NULL);
+};
+
+enum AdminEvent {
+    ADMIN_PENDING = 0,
+    ADMIN_REQUEST,
+    ADMIN_DONE
+};
+
+class AdminListener {
+private:
+    struct Connection {
+        std::string request;
+        std::string response;
+        size_t sent;
+        time_t opened;
+        
+        Connection() : sent(0), opened(0) {}
+    };
+    
+    static const size_t MAX_CONNECTIONS = 4;
+    static const size_t MAX_REQUEST = 4096;
+    
+    int _fd;
+    std::string _unixPath;
+    std::map<int, Connection> _connections;
+    
+    AdminListener(const AdminListener&);
+    AdminListener& operator=(const AdminListener&);
+    
+public:
+    AdminListener();
+    ~AdminListener();
+    
+    bool open(const std::string& address);
+    void close();
+    
+    int getFd() const { return _fd; }
+    bool owns(int fd) const { return _connections.find(fd) != _connections.end(); }
+    
+    int accept();
+    AdminEvent read(int fd, std::string& path);
+    void respond(int fd, int status, const char* reason, const char* contentType, const std::string& body);
+    AdminEvent write(int fd);
+    void drop(int fd);
+    int nextExpired(time_t now, time_t timeout) const;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#include "Arena.hpp"
+
+#include <cstdlib>
+
+Arena::Arena() : _current(0), _offset(0), _used(0), _highWater(0) {}
+
+Arena::~Arena() {
+    for (size_t i = 0; i < _chunks.size(); i++)
+        std::free(_chunks[i]);
+}
+
+Arena& Arena::tick() {
+    static Arena arena;
+    return arena;
+}
+
+void* Arena::_allocateSlow(size_t size) {
+    if (size > CHUNK_SIZE)
+        throw std::bad_alloc();
+    
+    if (!_chunks.empty() && _current + 1 < _chunks.size()) {
+        _current++;
+    } else {
+        char* chunk = static_cast<char*>(std::malloc(CHUNK_SIZE));
+        if (!chunk)
+            throw std::bad_alloc();
+        _chunks.push_back(chunk);
+        _current = _chunks.size() - 1;
+    }
+    
+    _offset = size;
+    _used += size;
+    return _chunks[_current];
+}
+
+void Arena::reset() {
+    if (_used > _highWater)
+        _highWater = _used;
+    
+    while (_chunks.size() > MAX_RETAINED_CHUNKS) {
+        std::free(_chunks.back());
+        _chunks.pop_back();
+    }
+    
+    _current = 0;
+    _offset = 0;
+    _used = 0;
+}
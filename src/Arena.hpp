@@ -0,0 +1,92 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <new>
+#include <string>
+#include <vector>
+
+class Arena {
+private:
+    std::vector<char*> _chunks;
+    size_t _current;
+    size_t _offset;
+    size_t _used;
+    size_t _highWater;
+    
+    static const size_t CHUNK_SIZE = 65536;
+    static const size_t MAX_RETAINED_CHUNKS = 16;
+    
+    void* _allocateSlow(size_t size);
+    
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+    
+public:
+    Arena();
+    ~Arena();
+    
+    void* allocate(size_t size) {
+        size = (size + sizeof(void*) * 2 - 1) & ~(sizeof(void*) * 2 - 1);
+        if (!_chunks.empty() && _offset + size <= CHUNK_SIZE) {
+            void* ptr = _chunks[_current] + _offset;
+            _offset += size;
+            _used += size;
+            return ptr;
+        }
+        return _allocateSlow(size);
+    }
+    
+    void reset();
+    
+    size_t getUsed() const { return _used; }
+    size_t getHighWater() const { return _highWater; }
+    size_t getChunkCount() const { return _chunks.size(); }
+    
+    static Arena& tick();
+};
+
+template <typename T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+    
+    template <typename U>
+    struct rebind {
+        typedef ArenaAllocator<U> other;
+    };
+    
+    ArenaAllocator() {}
+    ArenaAllocator(const ArenaAllocator&) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>&) {}
+    
+    pointer address(reference value) const { return &value; }
+    const_pointer address(const_reference value) const { return &value; }
+    
+    pointer allocate(size_type count, const void* = 0) {
+        return static_cast<pointer>(Arena::tick().allocate(count * sizeof(T)));
+    }
+    void deallocate(pointer, size_type) {}
+    
+    size_type max_size() const { return static_cast<size_type>(-1) / sizeof(T); }
+    void construct(pointer ptr, const T& value) { new (ptr) T(value); }
+    void destroy(pointer ptr) { ptr->~T(); }
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>&, const ArenaAllocator<U>&) { return true; }
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>&, const ArenaAllocator<U>&) { return false; }
+
+typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char> > ArenaString;
+typedef std::vector<std::string, ArenaAllocator<std::string> > Params;
+
+#endif
@@ -0,0 +1,281 @@
+#include "AuditLog.hpp"
+
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include <cerrno>
+#include <ctime>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+static long long nowMs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return static_cast<long long>(tv.tv_sec) * 1000 + tv.tv_usec / 1000;
+}
+
+AuditLog::AuditLog()
+    : _rotateBytes(64 * 1048576), _fsyncIntervalMs(1000), _delayThresholdMs(2000), _maxBuffer(4 * 1048576),
+      _stagingRecords(0), _stagingSince(0), _stagingDropped(0), _started(false), _stopping(false),
+      _activeRecords(0), _activeSince(0), _fd(-1), _fileSize(0), _rotations(0),
+      _torn(false), _written(0), _dropped(0), _delayed(0), _fsyncs(0), _failures(0), _lastError(0) {
+    pthread_mutex_init(&_mutex, NULL);
+    pthread_cond_init(&_cond, NULL);
+}
+
+AuditLog::~AuditLog() {
+    stop();
+    pthread_cond_destroy(&_cond);
+    pthread_mutex_destroy(&_mutex);
+}
+
+bool AuditLog::start(const std::string& path) {
+    if (_started || path.empty()) return _started;
+    
+    _path = path;
+    if (!_openFile())
+        return false;
+    
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &previous);
+    _stopping = false;
+    _started = pthread_create(&_thread, NULL, _run, this) == 0;
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    
+    if (!_started) {
+        close(_fd);
+        _fd = -1;
+    }
+    return _started;
+}
+
+void AuditLog::stop() {
+    if (!_started) return;
+    
+    pthread_mutex_lock(&_mutex);
+    if (!_staging.empty())
+        _transfer();
+    _stopping = true;
+    pthread_cond_signal(&_cond);
+    pthread_mutex_unlock(&_mutex);
+    
+    pthread_join(_thread, NULL);
+    _started = false;
+    
+    if (_fd != -1) {
+        fdatasync(_fd);
+        close(_fd);
+        _fd = -1;
+    }
+}
+
+void AuditLog::record(const std::string& channel, const std::string& line) {
+    if (!_started) return;
+    
+    if (_staging.size() + line.size() > _maxBuffer) {
+        _stagingDropped++;
+        return;
+    }
+    
+    long long now = nowMs();
+    if (_stagingRecords == 0)
+        _stagingSince = now;
+    
+    char stamp[32];
+    snprintf(stamp, sizeof(stamp), "%lld ", now);
+    _staging += stamp;
+    _staging += channel;
+    _staging += ' ';
+    _staging += line;
+    _staging += '\n';
+    _stagingRecords++;
+}
+
+void AuditLog::handoff() {
+    if (!_started || (_staging.empty() && _stagingDropped == 0)) return;
+    
+    if (pthread_mutex_trylock(&_mutex) != 0)
+        return;
+    
+    _transfer();
+    pthread_mutex_unlock(&_mutex);
+}
+
+void AuditLog::_transfer() {
+    _dropped += _stagingDropped;
+    _stagingDropped = 0;
+    if (_active.size() + _staging.size() > _maxBuffer) {
+        _dropped += _stagingRecords;
+    } else {
+        if (_activeRecords == 0)
+            _activeSince = _stagingSince;
+        _active += _staging;
+        _activeRecords += _stagingRecords;
+    }
+    pthread_cond_signal(&_cond);
+    
+    _staging.clear();
+    _stagingRecords = 0;
+}
+
+void* AuditLog::_run(void* self) {
+    static_cast<AuditLog*>(self)->_writerLoop();
+    return NULL;
+}
+
+void AuditLog::_writerLoop() {
+    std::string writing;
+    long long lastSync = nowMs();
+    bool dirty = false;
+    
+    pthread_mutex_lock(&_mutex);
+    for (;;) {
+        if (_active.empty() && !_stopping) {
+            long long deadline = lastSync + _fsyncIntervalMs;
+            struct timespec wake;
+            wake.tv_sec = static_cast<time_t>(deadline / 1000);
+            wake.tv_nsec = static_cast<long>(deadline % 1000) * 1000000;
+            pthread_cond_timedwait(&_cond, &_mutex, &wake);
+        }
+        
+        writing.swap(_active);
+        size_t records = _activeRecords;
+        long long since = _activeSince;
+        _activeRecords = 0;
+        bool stopping = _stopping;
+        pthread_mutex_unlock(&_mutex);
+        
+        int error = 0;
+        size_t lost = 0;
+        if (!writing.empty()) {
+            lost = _writeAll(writing, records, error);
+            writing.clear();
+            dirty = dirty || lost < records;
+        }
+        
+        long long now = nowMs();
+        bool synced = false;
+        if (dirty && _fd != -1 && (now - lastSync >= _fsyncIntervalMs || stopping)) {
+            if (fdatasync(_fd) == -1)
+                error = errno;
+            synced = true;
+            dirty = false;
+        }
+        if (synced || !dirty)
+            lastSync = now;
+        if (_fd != -1 && _fileSize >= _rotateBytes && !_rotate())
+            error = errno;
+        
+        pthread_mutex_lock(&_mutex);
+        _written += records - lost;
+        _dropped += lost;
+        if (error) {
+            _failures++;
+            _lastError = error;
+        }
+        if (records && now - since > _delayThresholdMs)
+            _delayed += records;
+        if (synced)
+            _fsyncs++;
+        if (stopping && _active.empty())
+            break;
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+size_t AuditLog::_writeAll(const std::string& data, size_t records, int& error) {
+    if (_fd == -1 && !_openFile()) {
+        error = errno;
+        return records;
+    }
+    if (_torn && write(_fd, "\n", 1) == 1) {
+        _torn = false;
+        _fileSize++;
+    }
+    
+    size_t offset = 0;
+    while (offset < data.size()) {
+        ssize_t written = write(_fd, data.data() + offset, data.size() - offset);
+        if (written == -1) {
+            if (errno == EINTR) continue;
+            error = errno;
+            close(_fd);
+            _fd = -1;
+            break;
+        }
+        offset += written;
+    }
+    _fileSize += offset;
+    
+    if (offset == data.size())
+        return 0;
+    _torn = offset > 0 && data[offset - 1] != '\n';
+    return records - std::count(data.begin(), data.begin() + offset, '\n');
+}
+
+bool AuditLog::_openFile() {
+    _fd = open(_path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0600);
+    if (_fd == -1)
+        return false;
+    
+    off_t size = lseek(_fd, 0, SEEK_END);
+    _fileSize = size > 0 ? static_cast<size_t>(size) : 0;
+    return true;
+}
+
+bool AuditLog::_rotate() {
+    fdatasync(_fd);
+    close(_fd);
+    _fd = -1;
+    
+    std::ostringstream rotated;
+    rotated << _path << "." << time(NULL) << "." << ++_rotations;
+    rename(_path.c_str(), rotated.str().c_str());
+    
+    return _openFile();
+}
+
+size_t AuditLog::getWritten() {
+    pthread_mutex_lock(&_mutex);
+    size_t value = _written;
+    pthread_mutex_unlock(&_mutex);
+    return value;
+}
+
+size_t AuditLog::getDropped() {
+    pthread_mutex_lock(&_mutex);
+    size_t value = _dropped;
+    pthread_mutex_unlock(&_mutex);
+    return value + _stagingDropped;
+}
+
+size_t AuditLog::getDelayed() {
+    pthread_mutex_lock(&_mutex);
+    size_t value = _delayed;
+    pthread_mutex_unlock(&_mutex);
+    return value;
+}
+
+size_t AuditLog::getFsyncs() {
+    pthread_mutex_lock(&_mutex);
+    size_t value = _fsyncs;
+    pthread_mutex_unlock(&_mutex);
+    return value;
+}
+
+size_t AuditLog::getFailures() {
+    pthread_mutex_lock(&_mutex);
+    size_t value = _failures;
+    pthread_mutex_unlock(&_mutex);
+    return value;
+}
+
+int AuditLog::getLastError() {
+    pthread_mutex_lock(&_mutex);
+    int value = _lastError;
+    pthread_mutex_unlock(&_mutex);
+    return value;
+}
@@ -0,0 +1,75 @@
+#ifndef AUDITLOG_HPP
+#define AUDITLOG_HPP
+
+#include <string>
+#include <pthread.h>
+
+class AuditLog {
+private:
+    std::string _path;
+    size_t _rotateBytes;
+    long _fsyncIntervalMs;
+    long _delayThresholdMs;
+    size_t _maxBuffer;
+    
+    std::string _staging;
+    size_t _stagingRecords;
+    long long _stagingSince;
+    size_t _stagingDropped;
+    
+    pthread_t _thread;
+    pthread_mutex_t _mutex;
+    pthread_cond_t _cond;
+    bool _started;
+    bool _stopping;
+    
+    std::string _active;
+    size_t _activeRecords;
+    long long _activeSince;
+    
+    int _fd;
+    size_t _fileSize;
+    size_t _rotations;
+    bool _torn;
+    
+    size_t _written;
+    size_t _dropped;
+    size_t _delayed;
+    size_t _fsyncs;
+    size_t _failures;
+    int _lastError;
+    
+    static void* _run(void* self);
+    void _writerLoop();
+    void _transfer();
+    bool _openFile();
+    bool _rotate();
+    size_t _writeAll(const std::string& data, size_t records, int& error);
+    
+    AuditLog(const AuditLog&);
+    AuditLog& operator=(const AuditLog&);
+    
+public:
+    AuditLog();
+    ~AuditLog();
+    
+    bool start(const std::string& path);
+    void stop();
+    
+    void record(const std::string& channel, const std::string& line);
+    void handoff();
+    
+    void setRotateBytes(size_t bytes) { _rotateBytes = bytes; }
+    void setFsyncIntervalMs(long intervalMs) { _fsyncIntervalMs = intervalMs > 0 ? intervalMs : 1; }
+    void setMaxBuffer(size_t bytes) { _maxBuffer = bytes; }
+    
+    bool isStarted() const { return _started; }
+    size_t getWritten();
+    size_t getDropped();
+    size_t getDelayed();
+    size_t getFsyncs();
+    size_t getFailures();
+    int getLastError();
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "BufferPool.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+BufferPool::BufferPool() : _trimmed(0) {
+    size_t size = 512;
+    for (size_t i = 0; i < CLASS_COUNT; i++, size *= 4) {
+        _classes[i].size = size;
+        _classes[i].inUse = 0;
+    }
+}
+
+BufferPool::~BufferPool() {
+    for (size_t i = 0; i < CLASS_COUNT; i++)
+        for (size_t j = 0; j < _classes[i].free.size(); j++)
+            std::free(_classes[i].free[j]);
+}
+
+BufferPool& BufferPool::instance() {
+    static BufferPool pool;
+    return pool;
+}
+
+char* BufferPool::acquire(size_t minimum, size_t& capacity) {
+    size_t index = 0;
+    while (index < CLASS_COUNT - 1 && _classes[index].size < minimum)
+        index++;
+    
+    SizeClass& sizeClass = _classes[index];
+    capacity = sizeClass.size < minimum ? minimum : sizeClass.size;
+    sizeClass.inUse++;
+    
+    if (capacity == sizeClass.size && !sizeClass.free.empty()) {
+        char* block = sizeClass.free.back();
+        sizeClass.free.pop_back();
+        return block;
+    }
+    
+    char* block = static_cast<char*>(std::malloc(capacity));
+    if (!block) {
+        sizeClass.inUse--;
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+void BufferPool::release(char* block, size_t capacity) {
+    size_t index = 0;
+    while (index < CLASS_COUNT - 1 && _classes[index].size < capacity)
+        index++;
+    
+    SizeClass& sizeClass = _classes[index];
+    sizeClass.inUse--;
+    
+    if (capacity == sizeClass.size)
+        sizeClass.free.push_back(block);
+    else
+        std::free(block);
+}
+
+size_t BufferPool::trim() {
+    size_t freed = 0;
+    
+    for (size_t i = 0; i < CLASS_COUNT; i++) {
+        SizeClass& sizeClass = _classes[i];
+        size_t keep = sizeClass.inUse / 4 + (i < 3 ? 16 : 0);
+        
+        while (sizeClass.free.size() > keep) {
+            std::free(sizeClass.free.back());
+            sizeClass.free.pop_back();
+            freed += sizeClass.size;
+        }
+    }
+    
+    _trimmed += freed;
+    return freed;
+}
+
+void Buffer::append(const char* bytes, size_t length) {
+    if (length == 0) return;
+    
+    if (_end + length > _capacity) {
+        size_t used = size();
+        
+        if (_data && used + length <= _capacity) {
+            memmove(_data, _data + _start, used);
+        } else {
+            size_t capacity;
+            char* block = BufferPool::instance().acquire(used + length, capacity);
+            if (_data) {
+                memcpy(block, _data + _start, used);
+                BufferPool::instance().release(_data, _capacity);
+            }
+            _data = block;
+            _capacity = capacity;
+        }
+        _start = 0;
+        _end = used;
+    }
+    
+    memcpy(_data + _end, bytes, length);
+    _end += length;
+}
+
+void Buffer::consume(size_t bytes) {
+    _start += bytes;
+    if (_start >= _end)
+        clear();
+}
+
+void Buffer::clear() {
+    if (_data)
+        BufferPool::instance().release(_data, _capacity);
+    _data = NULL;
+    _capacity = 0;
+    _start = 0;
+    _end = 0;
+}
@@ -0,0 +1,61 @@
+#ifndef BUFFERPOOL_HPP
+#define BUFFERPOOL_HPP
+
+#include <cstddef>
+#include <vector>
+
+class BufferPool {
+public:
+    struct SizeClass {
+        size_t size;
+        std::vector<char*> free;
+        size_t inUse;
+    };
+    
+    static const size_t CLASS_COUNT = 7;
+    
+private:
+    SizeClass _classes[CLASS_COUNT];
+    size_t _trimmed;
+    
+    BufferPool();
+    ~BufferPool();
+    BufferPool(const BufferPool&);
+    BufferPool& operator=(const BufferPool&);
+    
+public:
+    static BufferPool& instance();
+    
+    char* acquire(size_t minimum, size_t& capacity);
+    void release(char* block, size_t capacity);
+    size_t trim();
+    
+    const SizeClass& getClass(size_t index) const { return _classes[index]; }
+    size_t getTrimmed() const { return _trimmed; }
+};
+
+class Buffer {
+private:
+    char* _data;
+    size_t _capacity;
+    size_t _start;
+    size_t _end;
+    
+    Buffer(const Buffer&);
+    Buffer& operator=(const Buffer&);
+    
+public:
+    Buffer() : _data(NULL), _capacity(0), _start(0), _end(0) {}
+    ~Buffer() { clear(); }
+    
+    const char* data() const { return _data + _start; }
+    size_t size() const { return _end - _start; }
+    bool empty() const { return _end == _start; }
+    size_t capacity() const { return _capacity; }
+    
+    void append(const char* bytes, size_t length);
+    void consume(size_t bytes);
+    void clear();
+};
+
+#endif
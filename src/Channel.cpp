@@ -1,21 +1,46 @@
 #include "Channel.hpp"
 #include "Client.hpp"
 #include "Server.hpp"
+#include "ChannelHistory.hpp"
 #include <sstream>
 #include <algorithm>
 
+unsigned long Channel::_generationCounter = 0;
+
+static SlabPool& channelPool() {
+    static SlabPool pool("channel", sizeof(Channel));
+    return pool;
+}
+
+void* Channel::operator new(size_t size) {
+    if (size != sizeof(Channel))
+        return ::operator new(size);
+    return channelPool().allocate();
+}
+
+void Channel::operator delete(void* ptr, size_t size) {
+    if (size != sizeof(Channel))
+        ::operator delete(ptr);
+    else
+        channelPool().deallocate(ptr);
+}
+
 Channel::Channel(const std::string& name) 
-    : _name(name), _topicSetTime(0), _inviteOnly(false), _topicRestricted(true), 
+    : _name(name), _topicSetTime(0), _listGeneration(++_generationCounter), _inviteOnly(false), _topicRestricted(true), 
       _hasKey(false), _moderated(false), _noExternalMessages(true), 
-      _secret(false), _private(false), _userLimit(0), _server(NULL) {
+      _secret(false), _private(false), _audited(false), _userLimit(0), _server(NULL),
+      _joinWindowStart(0), _joinWindowCount(0), _namesLineLength(0), _namesDirty(true), _history(NULL) {
     
     time(&_creationTime);
+    _emptySince = _creationTime;
 }
 
 Channel::~Channel() {
-    std::set<Client*> clientsCopy = _clients;
-    for (std::set<Client*>::iterator it = clientsCopy.begin(); it != clientsCopy.end(); ++it)
+    ClientSet clientsCopy = _clients;
+    for (ClientSet::iterator it = clientsCopy.begin(); it != clientsCopy.end(); ++it)
         (*it)->leaveChannel(this);
+    clearInvites();
+    delete _history;
 }
 
 void Channel::setTopic(const std::string& topic, Client* setter) {
@@ -64,6 +89,9 @@ void Channel::setUserLimit(int limit) {
 void Channel::addClient(Client* client) {
     if (client && _clients.find(client) == _clients.end()) {
         _clients.insert(client);
+        _namesDirty = true;
+        if (_server)
+            _server->reindexChannel(this, _clients.size() - 1);
         if (_clients.size() == 1)
             addOperator(client);
         removeInvited(client);
@@ -71,15 +99,28 @@ void Channel::addClient(Client* client) {
 }
 
 void Channel::removeClient(Client* client) {
-    if (client) {
-        _clients.erase(client);
+    if (client && _clients.erase(client)) {
         _operators.erase(client);
-        _invited.erase(client);
+        removeInvited(client);
+        _namesDirty = true;
+        if (_server)
+            _server->reindexChannel(this, _clients.size() + 1);
+        
+        std::vector<Client*>::iterator pending = std::find(_pendingJoins.begin(), _pendingJoins.end(), client);
+        if (pending != _pendingJoins.end())
+            _pendingJoins.erase(pending);
+        
         if (_operators.empty() && !_clients.empty()) {
-            std::set<Client*>::iterator it = _clients.begin();
+            ClientSet::iterator it = _clients.begin();
             if (it != _clients.end())
                 addOperator(*it);
         }
+        
+        if (_clients.empty()) {
+            time(&_emptySince);
+            if (_server)
+                _server->scheduleChannelRemoval(this);
+        }
     }
 }
 
@@ -88,13 +129,13 @@ bool Channel::hasClient(Client* client) const {
 }
 
 void Channel::addOperator(Client* client) {
-    if (client && hasClient(client))
-        _operators.insert(client);
+    if (client && hasClient(client) && _operators.insert(client).second)
+        _namesDirty = true;
 }
 
 void Channel::removeOperator(Client* client) {
-    if (client && _operators.size() > 1)
-        _operators.erase(client);
+    if (client && _operators.size() > 1 && _operators.erase(client))
+        _namesDirty = true;
 }
 
 bool Channel::isOperator(Client* client) const {
@@ -102,31 +143,128 @@ bool Channel::isOperator(Client* client) const {
 }
 
 void Channel::addInvited(Client* client) {
-    if (client)
-        _invited.insert(client);
+    if (client && _invited.insert(client).second)
+        client->addInvite(this);
 }
 
 void Channel::removeInvited(Client* client) {
-    if (client)
-        _invited.erase(client);
+    if (client && _invited.erase(client))
+        client->removeInvite(this);
+}
+
+void Channel::clearInvites() {
+    for (ClientSet::iterator it = _invited.begin(); it != _invited.end(); ++it)
+        (*it)->removeInvite(this);
+    _invited.clear();
 }
 
 bool Channel::isInvited(Client* client) const {
     return _invited.find(client) != _invited.end();
 }
 
-void Channel::addBanned(Client* client) {
-    if (client)
-        _banned.insert(client);
+std::string Channel::normalizeMask(const std::string& mask) {
+    size_t bang = mask.find('!');
+    size_t at = mask.find('@');
+    
+    if (bang == std::string::npos && at == std::string::npos)
+        return mask + "!*@*";
+    if (bang == std::string::npos)
+        return "*!" + mask;
+    if (at == std::string::npos)
+        return mask + "@*";
+    return mask;
 }
 
-void Channel::removeBanned(Client* client) {
-    if (client)
-        _banned.erase(client);
+std::vector<ChannelListEntry>* Channel::_maskList(char type) {
+    if (type == 'b') return &_bans;
+    if (type == 'e') return &_exceptions;
+    if (type == 'I') return &_inviteExceptions;
+    return NULL;
+}
+
+bool Channel::addMask(char type, const std::string& mask, const std::string& setter) {
+    std::vector<ChannelListEntry>* list = _maskList(type);
+    if (!list || list->size() >= MAX_LIST_ENTRIES) return false;
+    
+    Mask compiled(normalizeMask(mask));
+    for (size_t i = 0; i < list->size(); i++)
+        if ((*list)[i].mask.getPattern() == compiled.getPattern())
+            return false;
+    
+    ChannelListEntry entry;
+    entry.mask = compiled;
+    entry.text = normalizeMask(mask);
+    entry.setter = setter;
+    entry.setTime = time(NULL);
+    list->push_back(entry);
+    _listGeneration = ++_generationCounter;
+    return true;
+}
+
+bool Channel::removeMask(char type, const std::string& mask) {
+    std::vector<ChannelListEntry>* list = _maskList(type);
+    if (!list) return false;
+    
+    std::string pattern = ircCasefold(normalizeMask(mask));
+    for (std::vector<ChannelListEntry>::iterator it = list->begin(); it != list->end(); ++it) {
+        if (it->mask.getPattern() == pattern) {
+            list->erase(it);
+            _listGeneration = ++_generationCounter;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Channel::isMaskListFull(char type) {
+    std::vector<ChannelListEntry>* list = _maskList(type);
+    return list && list->size() >= MAX_LIST_ENTRIES;
+}
+
+const std::vector<ChannelListEntry>& Channel::getMaskList(char type) {
+    static const std::vector<ChannelListEntry> empty;
+    std::vector<ChannelListEntry>* list = _maskList(type);
+    return list ? *list : empty;
+}
+
+void Channel::clearBans() {
+    _bans.clear();
+    _listGeneration = ++_generationCounter;
+}
+
+bool Channel::_matchesAny(const std::vector<ChannelListEntry>& list, const std::string& identifier) {
+    for (size_t i = 0; i < list.size(); i++)
+        if (list[i].mask.matches(identifier))
+            return true;
+    return false;
+}
+
+bool Channel::_computeBanned(Client* client) const {
+    if (_bans.empty()) return false;
+    
+    std::string identifier = client->getNickname() + "!" + client->getUsername() + "@" + client->getHostname();
+    return _matchesAny(_bans, identifier) && !_matchesAny(_exceptions, identifier);
 }
 
 bool Channel::isBanned(Client* client) const {
-    return _banned.find(client) != _banned.end();
+    if (!client) return false;
+    if (_bans.empty()) return false;
+    if (!hasClient(client)) return _computeBanned(client);
+    
+    bool banned;
+    if (client->getCachedBan(this, _listGeneration, banned))
+        return banned;
+    
+    banned = _computeBanned(client);
+    client->cacheBan(this, _listGeneration, banned);
+    return banned;
+}
+
+bool Channel::isInviteExempt(Client* client) const {
+    if (!client || _inviteExceptions.empty()) return false;
+    
+    std::string identifier = client->getNickname() + "!" + client->getUsername() + "@" + client->getHostname();
+    return _matchesAny(_inviteExceptions, identifier);
 }
 
 bool Channel::canJoin(Client* client, const std::string& key) const {
@@ -136,7 +274,7 @@ bool Channel::canJoin(Client* client, const std::string& key) const {
 
     if (_userLimit > 0 && _clients.size() >= static_cast<size_t>(_userLimit))
         return false;
-    if (_inviteOnly && !isInvited(client))
+    if (_inviteOnly && !isInvited(client) && !isInviteExempt(client))
         return false;
     if (_hasKey && key != _key)
         return false;
@@ -158,7 +296,7 @@ bool Channel::canSpeak(Client* client) const {
 void Channel::broadcast(const std::string& message, Client* exclude) {
     if (!_server) return;
     
-    for (std::set<Client*>::const_iterator it = _clients.begin(); it != _clients.end(); ++it)
+    for (ClientSet::const_iterator it = _clients.begin(); it != _clients.end(); ++it)
         if (*it != exclude && (*it)->getFd() >= 0)
             _server->sendToClient((*it)->getFd(), message);
 }
@@ -173,6 +311,7 @@ std::string Channel::getModeString() const {
     if (_noExternalMessages) modes += "n";
     if (_secret) modes += "s";
     if (_private) modes += "p";
+    if (_audited) modes += "A";
     
     if (_hasKey) {
         modes += "k";
@@ -189,23 +328,43 @@ std::string Channel::getModeString() const {
     return modes + params;
 }
 
-std::string Channel::getNamesReply() const {
-    std::string names;
+const std::vector<std::string>& Channel::getNamesLines(size_t maxLength) const {
+    if (!_namesDirty && maxLength == _namesLineLength)
+        return _namesLines;
+    
+    _namesLines.clear();
+    std::string line;
     
-    for (std::set<Client*>::const_iterator it = _clients.begin(); it != _clients.end(); ++it) {
-        if (!names.empty()) names += " ";
+    for (ClientSet::const_iterator it = _clients.begin(); it != _clients.end(); ++it) {
+        std::string name = isOperator(*it) ? "@" + (*it)->getNickname() : (*it)->getNickname();
         
-        if (isOperator(*it))
-            names += "@";
-        names += (*it)->getNickname();
+        if (!line.empty() && line.length() + 1 + name.length() > maxLength) {
+            _namesLines.push_back(line);
+            line.clear();
+        }
+        if (!line.empty()) line += " ";
+        line += name;
     }
+    if (!line.empty())
+        _namesLines.push_back(line);
     
-    return names;
+    _namesLineLength = maxLength;
+    _namesDirty = false;
+    return _namesLines;
+}
+
+bool Channel::recordJoin(time_t now) {
+    if (now != _joinWindowStart) {
+        _joinWindowStart = now;
+        _joinWindowCount = 0;
+    }
+    
+    return ++_joinWindowCount > JOIN_STORM_THRESHOLD;
 }
 
 std::string Channel::getChannelInfo() const {
     std::ostringstream oss;
-    oss << _name << " " << _clients.size();
+    oss << _name.str() << " " << _clients.size();
     
     if (!_topic.empty())
         oss << " :" << _topic;
@@ -232,20 +391,26 @@ bool Channel::isValidChannelName(const std::string& name) const {
 }
 
 void Channel::cleanup() {
-    std::set<Client*> clientsToRemove;
+    ClientSet clientsToRemove;
     
-    for (std::set<Client*>::iterator it = _clients.begin(); it != _clients.end(); ++it)
+    for (ClientSet::iterator it = _clients.begin(); it != _clients.end(); ++it)
         if (!(*it)->isRegistered())
             clientsToRemove.insert(*it);
     
-    for (std::set<Client*>::iterator it = clientsToRemove.begin(); it != clientsToRemove.end(); ++it)
+    for (ClientSet::iterator it = clientsToRemove.begin(); it != clientsToRemove.end(); ++it)
         removeClient(*it);
     
-    std::set<Client*> invitesToRemove;
-    for (std::set<Client*>::iterator it = _invited.begin(); it != _invited.end(); ++it)
+    ClientSet invitesToRemove;
+    for (ClientSet::iterator it = _invited.begin(); it != _invited.end(); ++it)
         if (!(*it)->isRegistered())
             invitesToRemove.insert(*it);
     
-    for (std::set<Client*>::iterator it = invitesToRemove.begin(); it != invitesToRemove.end(); ++it)
-        _invited.erase(*it);
+    for (ClientSet::iterator it = invitesToRemove.begin(); it != invitesToRemove.end(); ++it)
+        removeInvited(*it);
+}
+
+void Channel::recordHistory(const char* line, size_t length) {
+    if (!_history)
+        _history = new ChannelHistory(_server ? _server->getHistoryDirectory() : "");
+    _history->append(line, length);
 }
\ No newline at end of file
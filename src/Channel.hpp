@@ -4,23 +4,39 @@
 #include <string>
 #include <set>
 #include <map>
+#include <vector>
 #include <ctime>
 
+#include "Mask.hpp"
+#include "Pool.hpp"
+#include "StringPool.hpp"
+
 class Client;
 class Server;
+class ChannelHistory;
+
+struct ChannelListEntry {
+    Mask mask;
+    std::string text;
+    std::string setter;
+    time_t setTime;
+};
 
 class Channel {
 private:
-    std::string _name;
+    InternedString _name;
     std::string _topic;
     std::string _topicSetBy;
     time_t _topicSetTime;
     std::string _key;
     
-    std::set<Client*> _clients;
-    std::set<Client*> _operators;
-    std::set<Client*> _invited;
-    std::set<Client*> _banned;
+    ClientSet _clients;
+    ClientSet _operators;
+    ClientSet _invited;
+    std::vector<ChannelListEntry> _bans;
+    std::vector<ChannelListEntry> _exceptions;
+    std::vector<ChannelListEntry> _inviteExceptions;
+    unsigned long _listGeneration;
     
     bool _inviteOnly;
     bool _topicRestricted;
@@ -29,29 +45,52 @@ private:
     bool _noExternalMessages;
     bool _secret;
     bool _private;
+    bool _audited;
     int _userLimit;
     
     time_t _creationTime;
+    time_t _emptySince;
     Server* _server;
     
+    time_t _joinWindowStart;
+    size_t _joinWindowCount;
+    std::vector<Client*> _pendingJoins;
+    
+    mutable std::vector<std::string> _namesLines;
+    mutable size_t _namesLineLength;
+    mutable bool _namesDirty;
+    
+    ChannelHistory* _history;
+    
+    static unsigned long _generationCounter;
+    
+    std::vector<ChannelListEntry>* _maskList(char type);
+    bool _computeBanned(Client* client) const;
+    static bool _matchesAny(const std::vector<ChannelListEntry>& list, const std::string& identifier);
+    
     static const size_t MAX_TOPIC_LENGTH = 307;
     static const size_t MAX_KEY_LENGTH = 23;
     static const size_t MAX_CHANNEL_NAME_LENGTH = 50;
     static const int MAX_USER_LIMIT = 999;
+    static const size_t JOIN_STORM_THRESHOLD = 20;
+    static const size_t MAX_LIST_ENTRIES = 50;
     
 public:
     Channel(const std::string& name);
     ~Channel();
     
-    const std::string& getName() const { return _name; }
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size);
+    
+    const std::string& getName() const { return _name.str(); }
+    const InternedString& getNameHandle() const { return _name; }
     const std::string& getTopic() const { return _topic; }
     const std::string& getTopicSetBy() const { return _topicSetBy; }
     time_t getTopicSetTime() const { return _topicSetTime; }
     const std::string& getKey() const { return _key; }
-    const std::set<Client*>& getClients() const { return _clients; }
-    const std::set<Client*>& getOperators() const { return _operators; }
-    const std::set<Client*>& getInvited() const { return _invited; }
-    const std::set<Client*>& getBanned() const { return _banned; }
+    const ClientSet& getClients() const { return _clients; }
+    const ClientSet& getOperators() const { return _operators; }
+    const ClientSet& getInvited() const { return _invited; }
     
     bool isInviteOnly() const { return _inviteOnly; }
     bool isTopicRestricted() const { return _topicRestricted; }
@@ -60,9 +99,11 @@ public:
     bool isNoExternalMessages() const { return _noExternalMessages; }
     bool isSecret() const { return _secret; }
     bool isPrivate() const { return _private; }
+    bool isAudited() const { return _audited; }
     int getUserLimit() const { return _userLimit; }
     size_t getClientCount() const { return _clients.size(); }
     time_t getCreationTime() const { return _creationTime; }
+    time_t getEmptySince() const { return _emptySince; }
     
     void setTopic(const std::string& topic, Client* setter = NULL);
     void setKey(const std::string& key);
@@ -73,6 +114,7 @@ public:
     void setNoExternalMessages(bool noExternal) { _noExternalMessages = noExternal; }
     void setSecret(bool secret) { _secret = secret; }
     void setPrivate(bool priv) { _private = priv; }
+    void setAudited(bool audited) { _audited = audited; }
     void setUserLimit(int limit);
     void removeUserLimit() { _userLimit = 0; }
     void setServer(Server* server) { _server = server; }
@@ -89,19 +131,34 @@ public:
     void addInvited(Client* client);
     void removeInvited(Client* client);
     bool isInvited(Client* client) const;
-    void clearInvites() { _invited.clear(); }
+    void clearInvites();
     
-    void addBanned(Client* client);
-    void removeBanned(Client* client);
+    bool addMask(char type, const std::string& mask, const std::string& setter);
+    bool removeMask(char type, const std::string& mask);
+    bool isMaskListFull(char type);
+    const std::vector<ChannelListEntry>& getMaskList(char type);
     bool isBanned(Client* client) const;
-    void clearBans() { _banned.clear(); }
+    bool isInviteExempt(Client* client) const;
+    void clearBans();
+    
+    static std::string normalizeMask(const std::string& mask);
     
     bool canJoin(Client* client, const std::string& key = "") const;
     bool canSpeak(Client* client) const;
     void broadcast(const std::string& message, Client* exclude = NULL);
     
     std::string getModeString() const;
-    std::string getNamesReply() const;
+    const std::vector<std::string>& getNamesLines(size_t maxLength) const;
+    void invalidateNames() { _namesDirty = true; }
+    
+    bool recordJoin(time_t now);
+    
+    void recordHistory(const char* line, size_t length);
+    const ChannelHistory* getHistory() const { return _history; }
+    void addPendingJoin(Client* client) { _pendingJoins.push_back(client); }
+    const std::vector<Client*>& getPendingJoins() const { return _pendingJoins; }
+    bool hasPendingJoins() const { return !_pendingJoins.empty(); }
+    void clearPendingJoins() { _pendingJoins.clear(); }
     std::string getChannelInfo() const;
     
     bool isEmpty() const { return _clients.empty(); }
@@ -0,0 +1,379 @@
+#include "ChannelHistory.hpp"
+
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <csignal>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+SegmentWorker::SegmentWorker() : _started(false), _stopping(false) {
+    pthread_mutex_init(&_mutex, NULL);
+    pthread_cond_init(&_cond, NULL);
+}
+
+SegmentWorker::~SegmentWorker() {
+    if (_started) {
+        pthread_mutex_lock(&_mutex);
+        _stopping = true;
+        pthread_cond_signal(&_cond);
+        pthread_mutex_unlock(&_mutex);
+        pthread_join(_thread, NULL);
+    }
+    pthread_cond_destroy(&_cond);
+    pthread_mutex_destroy(&_mutex);
+}
+
+SegmentWorker& SegmentWorker::instance() {
+    static SegmentWorker worker;
+    return worker;
+}
+
+void SegmentWorker::_enqueue(const std::string& path, char* data, size_t size, bool release) {
+    Job job;
+    job.path = path;
+    job.data = data;
+    job.size = size;
+    job.release = release;
+    
+    pthread_mutex_lock(&_mutex);
+    if (!_started) {
+        sigset_t all, previous;
+        sigfillset(&all);
+        pthread_sigmask(SIG_SETMASK, &all, &previous);
+        _started = pthread_create(&_thread, NULL, _run, this) == 0;
+        pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    }
+    _jobs.push_back(job);
+    pthread_cond_signal(&_cond);
+    pthread_mutex_unlock(&_mutex);
+}
+
+void SegmentWorker::prepare(const std::string& path, size_t size) {
+    _enqueue(path, NULL, size, false);
+}
+
+void SegmentWorker::release(const std::string& path, char* data, size_t size) {
+    _enqueue(path, data, size, true);
+}
+
+bool SegmentWorker::collect(const std::string& path, char*& data) {
+    pthread_mutex_lock(&_mutex);
+    std::map<std::string, char*>::iterator it = _ready.find(path);
+    bool done = it != _ready.end();
+    if (done) {
+        data = it->second;
+        _ready.erase(it);
+    }
+    pthread_mutex_unlock(&_mutex);
+    return done;
+}
+
+void SegmentWorker::abandon(const std::string& path, size_t size) {
+    char* data;
+    if (collect(path, data)) {
+        release(path, data, size);
+        return;
+    }
+    
+    pthread_mutex_lock(&_mutex);
+    _abandoned.insert(path);
+    pthread_mutex_unlock(&_mutex);
+}
+
+void* SegmentWorker::_run(void* self) {
+    static_cast<SegmentWorker*>(self)->_workerLoop();
+    return NULL;
+}
+
+void SegmentWorker::_workerLoop() {
+    pthread_mutex_lock(&_mutex);
+    for (;;) {
+        while (_jobs.empty() && !_stopping)
+            pthread_cond_wait(&_cond, &_mutex);
+        if (_jobs.empty())
+            break;
+        
+        Job job = _jobs.front();
+        _jobs.pop_front();
+        pthread_mutex_unlock(&_mutex);
+        
+        if (!job.release)
+            job.data = _prepare(job.path, job.size);
+        
+        pthread_mutex_lock(&_mutex);
+        if (!job.release && _abandoned.erase(job.path) == 0) {
+            _ready[job.path] = job.data;
+            continue;
+        }
+        pthread_mutex_unlock(&_mutex);
+        
+        if (job.data)
+            munmap(job.data, job.size);
+        unlink(job.path.c_str());
+        pthread_mutex_lock(&_mutex);
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+char* SegmentWorker::_prepare(const std::string& path, size_t size) {
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd == -1)
+        return NULL;
+    
+    void* data = MAP_FAILED;
+    if (posix_fallocate(fd, 0, size) == 0)
+        data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+    
+    if (data == MAP_FAILED) {
+        unlink(path.c_str());
+        return NULL;
+    }
+    
+    long page = sysconf(_SC_PAGESIZE);
+    for (size_t offset = 0; offset < size; offset += page)
+        static_cast<volatile char*>(data)[offset] = 0;
+    return static_cast<char*>(data);
+}
+
+ChannelHistory::ChannelHistory(const std::string& directory)
+    : _directory(directory), _memoryBytes(0), _nextSeq(0), _lastTimeMs(0), _diskFailed(directory.empty()),
+      _spareCount(0) {
+    static unsigned long counter = 0;
+    
+    std::ostringstream oss;
+    oss << std::hex << time(NULL) << getpid() << "x" << ++counter;
+    _id = oss.str();
+}
+
+ChannelHistory::~ChannelHistory() {
+    while (!_segments.empty())
+        _dropSegment();
+    if (!_sparePath.empty())
+        SegmentWorker::instance().abandon(_sparePath, SEGMENT_SIZE);
+}
+
+long long ChannelHistory::nowMs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return static_cast<long long>(tv.tv_sec) * 1000 + tv.tv_usec / 1000;
+}
+
+std::string ChannelHistory::formatTime(long long timeMs) {
+    time_t seconds = static_cast<time_t>(timeMs / 1000);
+    struct tm utc;
+    gmtime_r(&seconds, &utc);
+    
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
+             utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday,
+             utc.tm_hour, utc.tm_min, utc.tm_sec, static_cast<int>(timeMs % 1000));
+    return buffer;
+}
+
+bool ChannelHistory::parseTime(const std::string& timestamp, long long& timeMs) {
+    struct tm utc;
+    int millis = 0;
+    memset(&utc, 0, sizeof(utc));
+    
+    if (sscanf(timestamp.c_str(), "%d-%d-%dT%d:%d:%d.%dZ", &utc.tm_year, &utc.tm_mon, &utc.tm_mday,
+               &utc.tm_hour, &utc.tm_min, &utc.tm_sec, &millis) < 6)
+        return false;
+    
+    utc.tm_year -= 1900;
+    utc.tm_mon -= 1;
+    timeMs = static_cast<long long>(timegm(&utc)) * 1000 + millis;
+    return true;
+}
+
+std::string ChannelHistory::formatMsgid(unsigned long seq) const {
+    std::ostringstream oss;
+    oss << _id << "-" << seq;
+    return oss.str();
+}
+
+bool ChannelHistory::parseMsgid(const std::string& msgid, unsigned long& seq) const {
+    if (msgid.length() <= _id.length() + 1 || msgid.compare(0, _id.length(), _id) != 0
+        || msgid[_id.length()] != '-')
+        return false;
+    
+    const char* digits = msgid.c_str() + _id.length() + 1;
+    char* end;
+    seq = strtoul(digits, &end, 10);
+    return *end == '\0' && seq < _nextSeq;
+}
+
+void ChannelHistory::append(const char* line, size_t length) {
+    long long now = nowMs();
+    if (now < _lastTimeMs)
+        now = _lastTimeMs;
+    _lastTimeMs = now;
+    
+    _memory.push_back(HistoryEntry());
+    HistoryEntry& entry = _memory.back();
+    entry.seq = _nextSeq++;
+    entry.timeMs = now;
+    entry.line.assign(line, length);
+    _memoryBytes += length;
+    
+    while (_memory.size() > MEMORY_ENTRIES || _memoryBytes > MEMORY_BYTES) {
+        bool overflow = _memory.size() > MEMORY_ENTRIES * MEMORY_SLACK || _memoryBytes > MEMORY_BYTES * MEMORY_SLACK;
+        if (!_spill(_memory.front()) && !overflow)
+            break;
+        _memoryBytes -= _memory.front().line.length();
+        _memory.pop_front();
+    }
+}
+
+bool ChannelHistory::_spill(const HistoryEntry& entry) {
+    if (_diskFailed) return true;
+    
+    size_t recordSize = RECORD_HEADER + entry.line.length();
+    if (_segments.empty() || _segments.back().used + recordSize > SEGMENT_SIZE) {
+        if (!_openSegment(entry.seq))
+            return _diskFailed;
+    }
+    
+    Segment& segment = _segments.back();
+    if (segment.count % INDEX_STRIDE == 0)
+        segment.index.push_back(segment.used);
+    
+    unsigned int length = static_cast<unsigned int>(entry.line.length());
+    char* record = segment.data + segment.used;
+    memcpy(record, &entry.timeMs, sizeof(entry.timeMs));
+    memcpy(record + sizeof(entry.timeMs), &length, sizeof(length));
+    memcpy(record + RECORD_HEADER, entry.line.data(), length);
+    
+    segment.used += recordSize;
+    segment.count++;
+    return true;
+}
+
+void ChannelHistory::_requestSpare() {
+    std::ostringstream path;
+    path << _directory << "/" << _id << "." << _spareCount++ << ".seg";
+    _sparePath = path.str();
+    SegmentWorker::instance().prepare(_sparePath, SEGMENT_SIZE);
+}
+
+bool ChannelHistory::_openSegment(unsigned long firstSeq) {
+    if (_sparePath.empty())
+        _requestSpare();
+    
+    char* data;
+    if (!SegmentWorker::instance().collect(_sparePath, data))
+        return false;
+    
+    Segment segment;
+    segment.path = _sparePath;
+    _sparePath.clear();
+    if (!data) {
+        _diskFailed = true;
+        return false;
+    }
+    
+    segment.data = data;
+    segment.used = 0;
+    segment.firstSeq = firstSeq;
+    segment.count = 0;
+    _segments.push_back(segment);
+    _requestSpare();
+    
+    if (_segments.size() > MAX_SEGMENTS)
+        _dropSegment();
+    return true;
+}
+
+void ChannelHistory::_dropSegment() {
+    Segment& segment = _segments.front();
+    SegmentWorker::instance().release(segment.path, segment.data, SEGMENT_SIZE);
+    _segments.pop_front();
+}
+
+unsigned long ChannelHistory::getFirstSeq() const {
+    if (!_segments.empty())
+        return _segments.front().firstSeq;
+    if (!_memory.empty())
+        return _memory.front().seq;
+    return _nextSeq;
+}
+
+const char* ChannelHistory::_locate(unsigned long seq) const {
+    size_t low = 0;
+    size_t high = _segments.size();
+    
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (_segments[mid].firstSeq + _segments[mid].count <= seq)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    
+    if (low == _segments.size() || seq < _segments[low].firstSeq)
+        return NULL;
+    
+    const Segment& segment = _segments[low];
+    unsigned long offset = seq - segment.firstSeq;
+    const char* record = segment.data + segment.index[offset / INDEX_STRIDE];
+    
+    for (unsigned long skip = offset % INDEX_STRIDE; skip > 0; skip--) {
+        unsigned int length;
+        memcpy(&length, record + sizeof(long long), sizeof(length));
+        record += RECORD_HEADER + length;
+    }
+    return record;
+}
+
+bool ChannelHistory::fetch(unsigned long seq, HistoryEntry& entry) const {
+    if (seq >= _nextSeq)
+        return false;
+    
+    if (!_memory.empty() && seq >= _memory.front().seq) {
+        entry = _memory[seq - _memory.front().seq];
+        return true;
+    }
+    
+    const char* record = _locate(seq);
+    if (!record)
+        return false;
+    
+    unsigned int length;
+    entry.seq = seq;
+    memcpy(&entry.timeMs, record, sizeof(entry.timeMs));
+    memcpy(&length, record + sizeof(long long), sizeof(length));
+    entry.line.assign(record + RECORD_HEADER, length);
+    return true;
+}
+
+long long ChannelHistory::_timeOf(unsigned long seq) const {
+    if (!_memory.empty() && seq >= _memory.front().seq)
+        return _memory[seq - _memory.front().seq].timeMs;
+    
+    const char* record = _locate(seq);
+    if (!record)
+        return 0;
+    
+    long long timeMs;
+    memcpy(&timeMs, record, sizeof(timeMs));
+    return timeMs;
+}
+
+unsigned long ChannelHistory::findTime(long long timeMs) const {
+    unsigned long low = getFirstSeq();
+    unsigned long high = _nextSeq;
+    
+    while (low < high) {
+        unsigned long mid = low + (high - low) / 2;
+        if (_timeOf(mid) < timeMs)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
@@ -0,0 +1,114 @@
+#ifndef CHANNELHISTORY_HPP
+#define CHANNELHISTORY_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <pthread.h>
+
+struct HistoryEntry {
+    unsigned long seq;
+    long long timeMs;
+    std::string line;
+};
+
+class SegmentWorker {
+private:
+    struct Job {
+        std::string path;
+        char* data;
+        size_t size;
+        bool release;
+    };
+    
+    pthread_t _thread;
+    pthread_mutex_t _mutex;
+    pthread_cond_t _cond;
+    bool _started;
+    bool _stopping;
+    std::deque<Job> _jobs;
+    std::map<std::string, char*> _ready;
+    std::set<std::string> _abandoned;
+    
+    SegmentWorker();
+    ~SegmentWorker();
+    SegmentWorker(const SegmentWorker&);
+    SegmentWorker& operator=(const SegmentWorker&);
+    
+    static void* _run(void* self);
+    void _workerLoop();
+    void _enqueue(const std::string& path, char* data, size_t size, bool release);
+    static char* _prepare(const std::string& path, size_t size);
+    
+public:
+    static SegmentWorker& instance();
+    
+    void prepare(const std::string& path, size_t size);
+    bool collect(const std::string& path, char*& data);
+    void release(const std::string& path, char* data, size_t size);
+    void abandon(const std::string& path, size_t size);
+};
+
+class ChannelHistory {
+private:
+    struct Segment {
+        std::string path;
+        char* data;
+        size_t used;
+        unsigned long firstSeq;
+        unsigned long count;
+        std::vector<size_t> index;
+    };
+    
+    std::string _id;
+    std::string _directory;
+    std::deque<HistoryEntry> _memory;
+    size_t _memoryBytes;
+    std::deque<Segment> _segments;
+    unsigned long _nextSeq;
+    long long _lastTimeMs;
+    bool _diskFailed;
+    std::string _sparePath;
+    unsigned long _spareCount;
+    
+    bool _spill(const HistoryEntry& entry);
+    void _requestSpare();
+    bool _openSegment(unsigned long firstSeq);
+    void _dropSegment();
+    const char* _locate(unsigned long seq) const;
+    long long _timeOf(unsigned long seq) const;
+    
+    static const size_t MEMORY_BYTES = 65536;
+    static const size_t MEMORY_ENTRIES = 256;
+    static const size_t MEMORY_SLACK = 4;
+    static const size_t SEGMENT_SIZE = 1048576;
+    static const size_t MAX_SEGMENTS = 8;
+    static const size_t INDEX_STRIDE = 32;
+    static const size_t RECORD_HEADER = sizeof(long long) + sizeof(unsigned int);
+    
+    ChannelHistory(const ChannelHistory&);
+    ChannelHistory& operator=(const ChannelHistory&);
+    
+public:
+    explicit ChannelHistory(const std::string& directory);
+    ~ChannelHistory();
+    
+    void append(const char* line, size_t length);
+    bool fetch(unsigned long seq, HistoryEntry& entry) const;
+    
+    const std::string& getId() const { return _id; }
+    unsigned long getFirstSeq() const;
+    unsigned long getNextSeq() const { return _nextSeq; }
+    unsigned long findTime(long long timeMs) const;
+    
+    std::string formatMsgid(unsigned long seq) const;
+    bool parseMsgid(const std::string& msgid, unsigned long& seq) const;
+    
+    static long long nowMs();
+    static std::string formatTime(long long timeMs);
+    static bool parseTime(const std::string& timestamp, long long& timeMs);
+};
+
+#endif
@@ -1,84 +1,175 @@
 #include "Client.hpp"
 #include "Channel.hpp"
 #include "Server.hpp"
+#include "ReplyStream.hpp"
 #include <sstream>
 #include <algorithm>
+#include <cstring>
+
+static SlabPool& clientPool() {
+    static SlabPool pool("client", sizeof(Client));
+    return pool;
+}
+
+void* Client::operator new(size_t size) {
+    if (size != sizeof(Client))
+        return ::operator new(size);
+    return clientPool().allocate();
+}
+
+void Client::operator delete(void* ptr, size_t size) {
+    if (size != sizeof(Client))
+        ::operator delete(ptr);
+    else
+        clientPool().deallocate(ptr);
+}
 
 Client::Client(int fd, Server* server) 
-    : _fd(fd), _authenticated(false), _registered(false), 
-      _passwordProvided(false), _operator(false),
-      _messageCount(0) {
+    : _fd(fd), _server(server), _authenticated(false), _registered(false), 
+      _passwordProvided(false), _operator(false), _scheduled(false), _closing(false),
+      _readPaused(false), _messageCount(0), _fanoutMark(0), _identityGeneration(0),
+      _recentMessages(64, 2, 30) {
     
-    (void)server;  //Ghir save it for API compatibility, not stored tho
-    _hostname = "localhost";
+    _hostname = InternedString("localhost");
+    for (size_t i = 0; i < MAX_CHANNELS; i++)
+        _banSlots[i].channel = NULL;
     time(&_connectTime);
     _lastActivity = _connectTime;
     _lastMessageTime = _connectTime;
 }
 
 Client::~Client() {
-    std::set<Channel*> channelsCopy = _channels;
-    for (std::set<Channel*>::iterator it = channelsCopy.begin(); it != channelsCopy.end(); ++it)
+    while (!_streams.empty())
+        popStream();
+    if (_server)
+        _server->unindexClient(this);
+    
+    ChannelSet channelsCopy = _channels;
+    for (ChannelSet::iterator it = channelsCopy.begin(); it != channelsCopy.end(); ++it)
         leaveChannel(*it);
+    
+    ChannelSet invitesCopy = _invites;
+    for (ChannelSet::iterator it = invitesCopy.begin(); it != invitesCopy.end(); ++it)
+        (*it)->removeInvited(this);
 }
 
 void Client::setNickname(const std::string& nickname) {
     if (isValidNickname(nickname)) {
+        std::string oldNickname = _nickname;
         _nickname = nickname;
+        _identityGeneration++;
+        if (_server)
+            _server->reindexClientNick(this, oldNickname);
         updateActivity();
     }
 }
 
 void Client::setUsername(const std::string& username) {
     if (isValidUsername(username)) {
-        _username = username;
+        std::string oldUsername = _username.str();
+        _username = InternedString(username);
+        _identityGeneration++;
+        if (_server)
+            _server->reindexClientUser(this, oldUsername);
         updateActivity();
     }
 }
 
 void Client::setRealname(const std::string& realname) {
     if (!realname.empty() && realname.length() <= 255) {
-        _realname = realname;
+        _realname = InternedString(realname);
         updateActivity();
     }
 }
 
 void Client::setHostname(const std::string& hostname) {
-    if (!hostname.empty())
-        _hostname = hostname;
+    if (!hostname.empty()) {
+        std::string oldHostname = _hostname.str();
+        _hostname = InternedString(hostname);
+        _identityGeneration++;
+        if (_server)
+            _server->reindexClientHost(this, oldHostname);
+    }
 }
 
-void Client::appendToBuffer(const std::string& data) {
-    if (_buffer.length() + data.length() > MAX_BUFFER_SIZE) {
+void Client::appendToBuffer(const char* data, size_t length) {
+    if (_buffer.size() + length > MAX_BUFFER_SIZE) {
         _buffer.clear();
         return;
     }
-    _buffer += data;
+    _buffer.append(data, length);
     updateActivity();
 }
 
 std::vector<std::string> Client::extractMessages() {
     std::vector<std::string> messages;
-    size_t pos = 0;
+    const char* newline;
     
-    while ((pos = _buffer.find('\n')) != std::string::npos) {
-        std::string message = _buffer.substr(0, pos);
+    while (!_buffer.empty()
+           && (newline = static_cast<const char*>(memchr(_buffer.data(), '\n', _buffer.size())))) {
+        size_t length = newline - _buffer.data();
+        size_t consumed = length + 1;
         
-        if (!message.empty() && message[message.length() - 1] == '\r')
-            message = message.substr(0, message.length() - 1);
-        if (!message.empty() && message.length() <= MAX_MESSAGE_LENGTH) {
-            messages.push_back(message);
+        if (length > 0 && _buffer.data()[length - 1] == '\r')
+            length--;
+        if (length > 0 && length <= MAX_MESSAGE_LENGTH) {
+            messages.push_back(std::string(_buffer.data(), length));
             incrementMessageCount();
         }
-        _buffer = _buffer.substr(pos + 1);
+        _buffer.consume(consumed);
     }
     
-    if (_buffer.length() > MAX_MESSAGE_LENGTH)
+    if (_buffer.size() > MAX_MESSAGE_LENGTH)
         _buffer.clear();
 
     return messages;
 }
 
+bool Client::_isPriorityMessage(const std::string& message) {
+    if (message.length() < 4)
+        return false;
+    if (message.length() > 4 && message[4] != ' ')
+        return false;
+    
+    std::string cmd = message.substr(0, 4);
+    std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::toupper);
+    return cmd == "PING" || cmd == "PONG";
+}
+
+void Client::queueMessage(const std::string& message) {
+    if (_isPriorityMessage(message))
+        _priority.push_back(message);
+    else
+        _pending.push_back(message);
+}
+
+bool Client::popMessage(std::string& message) {
+    std::deque<std::string>& queue = _priority.empty() ? _pending : _priority;
+    if (queue.empty())
+        return false;
+    
+    message = queue.front();
+    queue.pop_front();
+    return true;
+}
+
+bool Client::popPriorityMessage(std::string& message) {
+    if (_priority.empty())
+        return false;
+    
+    message = _priority.front();
+    _priority.pop_front();
+    return true;
+}
+
+void Client::popStream() {
+    if (_streams.empty())
+        return;
+    
+    delete _streams.front();
+    _streams.pop_front();
+}
+
 void Client::joinChannel(Channel* channel) {
     if (channel && _channels.find(channel) == _channels.end() && canJoinMoreChannels()) {
         _channels.insert(channel);
@@ -100,6 +191,27 @@ bool Client::isInChannel(Channel* channel) const {
     return _channels.find(channel) != _channels.end();
 }
 
+size_t Client::_banSlot(const Channel* channel) {
+    return (reinterpret_cast<size_t>(channel) >> 4) * 2654435761UL % MAX_CHANNELS;
+}
+
+bool Client::getCachedBan(const Channel* channel, unsigned long listGeneration, bool& banned) const {
+    const BanSlot& slot = _banSlots[_banSlot(channel)];
+    if (slot.channel != channel || slot.listGeneration != listGeneration
+        || slot.identityGeneration != _identityGeneration)
+        return false;
+    banned = slot.banned;
+    return true;
+}
+
+void Client::cacheBan(const Channel* channel, unsigned long listGeneration, bool banned) {
+    BanSlot& slot = _banSlots[_banSlot(channel)];
+    slot.channel = channel;
+    slot.listGeneration = listGeneration;
+    slot.identityGeneration = _identityGeneration;
+    slot.banned = banned;
+}
+
 void Client::tryRegister() {
     if (_passwordProvided && !_nickname.empty() && !_username.empty() && !_registered) {
         _registered = true;
@@ -120,13 +232,13 @@ void Client::incrementMessageCount() {
 
 std::string Client::getPrefix() const {
     if (_nickname.empty())
-        return _hostname;
+        return _hostname.str();
 
     std::string prefix = _nickname;
     if (!_username.empty())
-        prefix += "!" + _username;
+        prefix += "!" + _username.str();
     if (!_hostname.empty())
-        prefix += "@" + _hostname;
+        prefix += "@" + _hostname.str();
     
     return prefix;
 }
@@ -137,13 +249,13 @@ std::string Client::getFullIdentifier() const {
     
     std::string identifier = _nickname;
     if (!_username.empty() && !_hostname.empty())
-        identifier += "!" + _username + "@" + _hostname;
+        identifier += "!" + _username.str() + "@" + _hostname.str();
     
     return identifier;
 }
 
 std::string Client::getMask() const {
-    return "*!" + _username + "@" + _hostname;
+    return "*!" + _username.str() + "@" + _hostname.str();
 }
 
 int Client::getIdleTime() const {
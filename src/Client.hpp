@@ -4,51 +4,92 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <deque>
 #include <ctime>
 
+#include "SpamDetector.hpp"
+#include "Pool.hpp"
+#include "BufferPool.hpp"
+#include "StringPool.hpp"
+
 class Channel;
 class Server;
+class ReplyStream;
 
 class Client {
 private:
     int _fd;
+    Server* _server;
     std::string _nickname;
-    std::string _username;
-    std::string _realname;
-    std::string _hostname;
-    std::string _buffer;
+    InternedString _username;
+    InternedString _realname;
+    InternedString _hostname;
+    Buffer _buffer;
+    std::deque<std::string> _pending;
+    std::deque<std::string> _priority;
+    Buffer _sendQueue;
+    std::deque<ReplyStream*> _streams;
     
     bool _authenticated;
     bool _registered;
     bool _passwordProvided;
     bool _operator;
+    bool _scheduled;
+    bool _closing;
+    bool _readPaused;
     
-    std::set<Channel*> _channels;
+    ChannelSet _channels;
+    ChannelSet _invites;
+    std::set<std::string> _monitoring;
     
     time_t _connectTime;
     time_t _lastActivity;
     size_t _messageCount;
     time_t _lastMessageTime;
+    unsigned long _fanoutMark;
+    unsigned long _identityGeneration;
+    CountMinSketch _recentMessages;
     
+    struct BanSlot {
+        const Channel* channel;
+        unsigned long listGeneration;
+        unsigned long identityGeneration;
+        bool banned;
+    };
     static const size_t MAX_BUFFER_SIZE = 8192;
     static const size_t MAX_MESSAGE_LENGTH = 512;
     static const size_t MAX_CHANNELS = 20;
+    static const size_t MAX_PENDING_MESSAGES = 64;
+    static const size_t MAX_SENDQ = 1048576;
+    static const size_t SENDQ_WATERMARK = 16384;
+    
+    BanSlot _banSlots[MAX_CHANNELS];
+    
+    static bool _isPriorityMessage(const std::string& message);
+    static size_t _banSlot(const Channel* channel);
     
 public:
     Client(int fd, Server* server);
     ~Client();
     
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size);
+    
     int getFd() const { return _fd; }
     const std::string& getNickname() const { return _nickname; }
-    const std::string& getUsername() const { return _username; }
-    const std::string& getRealname() const { return _realname; }
-    const std::string& getHostname() const { return _hostname; }
-    const std::string& getBuffer() const { return _buffer; }
+    const std::string& getUsername() const { return _username.str(); }
+    const std::string& getRealname() const { return _realname.str(); }
+    const std::string& getHostname() const { return _hostname.str(); }
+    const InternedString& getUsernameHandle() const { return _username; }
+    const InternedString& getRealnameHandle() const { return _realname; }
+    const InternedString& getHostnameHandle() const { return _hostname; }
+    size_t getBufferSize() const { return _buffer.size(); }
+    size_t getBufferCapacity() const { return _buffer.capacity() + _sendQueue.capacity(); }
     bool isAuthenticated() const { return _authenticated; }
     bool isRegistered() const { return _registered; }
     bool hasPasswordProvided() const { return _passwordProvided; }
     bool isOperator() const { return _operator; }
-    const std::set<Channel*>& getChannels() const { return _channels; }
+    const ChannelSet& getChannels() const { return _channels; }
     time_t getConnectTime() const { return _connectTime; }
     time_t getLastActivity() const { return _lastActivity; }
     size_t getMessageCount() const { return _messageCount; }
@@ -61,15 +102,55 @@ public:
     void setPasswordProvided(bool provided) { _passwordProvided = provided; }
     void setOperator(bool op) { _operator = op; }
     
-    void appendToBuffer(const std::string& data);
+    void appendToBuffer(const char* data, size_t length);
     std::vector<std::string> extractMessages();
     void clearBuffer() { _buffer.clear(); }
-    bool isBufferFull() const { return _buffer.length() >= MAX_BUFFER_SIZE; }
+    bool isBufferFull() const { return _buffer.size() >= MAX_BUFFER_SIZE; }
+    
+    void queueMessage(const std::string& message);
+    bool popMessage(std::string& message);
+    bool popPriorityMessage(std::string& message);
+    bool hasPendingMessages() const { return !_priority.empty() || !_pending.empty(); }
+    bool hasPriorityMessages() const { return !_priority.empty(); }
+    size_t getPendingCount() const { return _priority.size() + _pending.size(); }
+    bool isBacklogFull() const { return _priority.size() + _pending.size() >= MAX_PENDING_MESSAGES; }
+    bool isScheduled() const { return _scheduled; }
+    void setScheduled(bool scheduled) { _scheduled = scheduled; }
+    bool isClosing() const { return _closing; }
+    void setClosing(bool closing) { _closing = closing; }
+    bool isReadPaused() const { return _readPaused; }
+    void setReadPaused(bool paused) { _readPaused = paused; }
+    unsigned long getIdentityGeneration() const { return _identityGeneration; }
+    unsigned long getFanoutMark() const { return _fanoutMark; }
+    void setFanoutMark(unsigned long mark) { _fanoutMark = mark; }
+    CountMinSketch& getRecentMessages() { return _recentMessages; }
+    
+    void queueOutput(const std::string& data) { _sendQueue.append(data.data(), data.size()); }
+    void queueOutput(const char* data, size_t length) { _sendQueue.append(data, length); }
+    const Buffer& getSendQueue() const { return _sendQueue; }
+    void consumeSendQueue(size_t bytes) { _sendQueue.consume(bytes); }
+    size_t getSendQueueSize() const { return _sendQueue.size(); }
+    bool isSendQueueFull() const { return _sendQueue.size() > MAX_SENDQ; }
+    bool isSendQueueAboveWatermark() const { return _sendQueue.size() >= SENDQ_WATERMARK; }
+    
+    ReplyStream* getStream() const { return _streams.empty() ? NULL : _streams.front(); }
+    void pushStream(ReplyStream* stream) { _streams.push_back(stream); }
+    void popStream();
+    
+    const std::set<std::string>& getMonitoring() const { return _monitoring; }
+    bool addMonitor(const std::string& foldedNick) { return _monitoring.insert(foldedNick).second; }
+    bool removeMonitor(const std::string& foldedNick) { return _monitoring.erase(foldedNick) > 0; }
+    void clearMonitors() { _monitoring.clear(); }
+    
+    void addInvite(Channel* channel) { _invites.insert(channel); }
+    void removeInvite(Channel* channel) { _invites.erase(channel); }
     
     void joinChannel(Channel* channel);
     void leaveChannel(Channel* channel);
     bool isInChannel(Channel* channel) const;
     bool canJoinMoreChannels() const { return _channels.size() < MAX_CHANNELS; }
+    bool getCachedBan(const Channel* channel, unsigned long listGeneration, bool& banned) const;
+    void cacheBan(const Channel* channel, unsigned long listGeneration, bool banned);
     
     void tryRegister();
     void updateActivity();
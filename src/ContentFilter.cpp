@@ -0,0 +1,228 @@
+#include "ContentFilter.hpp"
+
+#include <map>
+#include <deque>
+#include <sstream>
+#include <cctype>
+#include <csignal>
+
+static unsigned char foldByte(unsigned char c) {
+    return static_cast<unsigned char>(tolower(c));
+}
+
+FilterAutomaton::FilterAutomaton(const std::vector<FilterRule>& rules) : _rules(rules), _rejected(0) {
+    std::vector<std::map<unsigned char, int> > trie(1);
+    std::vector<int> terminal(1, -1);
+    
+    for (size_t i = 0; i < _rules.size(); i++) {
+        const FilterRule& rule = _rules[i];
+        
+        if (rule.regex) {
+            regex_t* compiled = new regex_t;
+            if (rule.pattern.empty() || rule.pattern[0] != '^'
+                || regcomp(compiled, rule.pattern.c_str(), REG_EXTENDED | REG_ICASE | REG_NOSUB) != 0) {
+                delete compiled;
+                _rejected++;
+                continue;
+            }
+            _regexes.push_back(std::make_pair(compiled, i));
+            continue;
+        }
+        
+        if (rule.pattern.empty()) {
+            _rejected++;
+            continue;
+        }
+        
+        int node = 0;
+        for (size_t j = 0; j < rule.pattern.length(); j++) {
+            unsigned char c = foldByte(rule.pattern[j]);
+            std::map<unsigned char, int>::iterator it = trie[node].find(c);
+            if (it == trie[node].end()) {
+                trie[node][c] = static_cast<int>(trie.size());
+                node = static_cast<int>(trie.size());
+                trie.push_back(std::map<unsigned char, int>());
+                terminal.push_back(-1);
+            } else
+                node = it->second;
+        }
+        if (terminal[node] == -1 || rule.action > _rules[terminal[node]].action)
+            terminal[node] = static_cast<int>(i);
+    }
+    
+    int classOf[256] = { 0 };
+    _classCount = 1;
+    for (size_t i = 0; i < trie.size(); i++)
+        for (std::map<unsigned char, int>::iterator it = trie[i].begin(); it != trie[i].end(); ++it)
+            if (classOf[it->first] == 0)
+                classOf[it->first] = static_cast<int>(_classCount++);
+    for (int c = 0; c < 256; c++)
+        _classes[c] = static_cast<unsigned char>(classOf[foldByte(static_cast<unsigned char>(c))]);
+    
+    _states.resize(trie.size());
+    for (size_t i = 0; i < trie.size(); i++) {
+        _states[i].rule = terminal[i];
+        _states[i].action = terminal[i] == -1 ? FILTER_NONE : _rules[terminal[i]].action;
+    }
+    
+    _delta.assign(trie.size() * _classCount, 0);
+    std::vector<int> fail(trie.size(), 0);
+    std::deque<int> queue;
+    
+    for (std::map<unsigned char, int>::iterator it = trie[0].begin(); it != trie[0].end(); ++it) {
+        _delta[classOf[it->first]] = it->second;
+        queue.push_back(it->second);
+    }
+    
+    while (!queue.empty()) {
+        int node = queue.front();
+        queue.pop_front();
+        
+        int* row = &_delta[node * _classCount];
+        const int* failRow = &_delta[fail[node] * _classCount];
+        for (size_t k = 0; k < _classCount; k++)
+            row[k] = failRow[k];
+        
+        for (std::map<unsigned char, int>::iterator it = trie[node].begin(); it != trie[node].end(); ++it) {
+            int child = it->second;
+            fail[child] = failRow[classOf[it->first]];
+            row[classOf[it->first]] = child;
+            
+            const State& inherited = _states[fail[child]];
+            if (inherited.action > _states[child].action) {
+                _states[child].action = inherited.action;
+                _states[child].rule = inherited.rule;
+            }
+            queue.push_back(child);
+        }
+    }
+}
+
+FilterAutomaton::~FilterAutomaton() {
+    for (size_t i = 0; i < _regexes.size(); i++) {
+        regfree(_regexes[i].first);
+        delete _regexes[i].first;
+    }
+}
+
+FilterAction FilterAutomaton::match(const std::string& text, size_t& rule) const {
+    FilterAction best = FILTER_NONE;
+    int state = 0;
+    
+    for (size_t i = 0; i < text.length(); i++) {
+        state = _delta[state * _classCount + _classes[static_cast<unsigned char>(text[i])]];
+        if (_states[state].action > best) {
+            best = _states[state].action;
+            rule = _states[state].rule;
+            if (best == FILTER_BLOCK)
+                return best;
+        }
+    }
+    
+    for (size_t i = 0; i < _regexes.size(); i++) {
+        const FilterRule& candidate = _rules[_regexes[i].second];
+        if (candidate.action > best && regexec(_regexes[i].first, text.c_str(), 0, NULL, 0) == 0) {
+            best = candidate.action;
+            rule = _regexes[i].second;
+        }
+    }
+    return best;
+}
+
+ContentFilter::ContentFilter() : _active(NULL), _ready(NULL), _compiling(false) {
+    pthread_mutex_init(&_mutex, NULL);
+}
+
+ContentFilter::~ContentFilter() {
+    if (_compiling)
+        pthread_join(_thread, NULL);
+    delete _ready;
+    delete _active;
+    pthread_mutex_destroy(&_mutex);
+}
+
+bool ContentFilter::parseRules(std::istream& input, std::vector<FilterRule>& rules) {
+    std::string line;
+    bool valid = true;
+    
+    while (std::getline(input, line)) {
+        if (!line.empty() && line[line.length() - 1] == '\r')
+            line.erase(line.length() - 1);
+        if (line.empty() || line[0] == '#')
+            continue;
+        
+        size_t space = line.find(' ');
+        std::string action = line.substr(0, space);
+        FilterRule rule;
+        rule.pattern = space == std::string::npos ? "" : line.substr(space + 1);
+        rule.regex = rule.pattern.compare(0, 3, "re:") == 0;
+        if (rule.regex)
+            rule.pattern.erase(0, 3);
+        
+        if (action == "block") rule.action = FILTER_BLOCK;
+        else if (action == "tag") rule.action = FILTER_TAG;
+        else if (action == "log") rule.action = FILTER_LOG;
+        else rule.action = FILTER_NONE;
+        
+        if (rule.action == FILTER_NONE || rule.pattern.empty()) {
+            valid = false;
+            continue;
+        }
+        rules.push_back(rule);
+    }
+    return valid;
+}
+
+bool ContentFilter::compile(const std::vector<FilterRule>& rules) {
+    if (_compiling) return false;
+    
+    _building = rules;
+    
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &previous);
+    _compiling = pthread_create(&_thread, NULL, _compile, this) == 0;
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    
+    return _compiling;
+}
+
+void* ContentFilter::_compile(void* self) {
+    ContentFilter* filter = static_cast<ContentFilter*>(self);
+    FilterAutomaton* automaton = new FilterAutomaton(filter->_building);
+    
+    pthread_mutex_lock(&filter->_mutex);
+    filter->_ready = automaton;
+    pthread_mutex_unlock(&filter->_mutex);
+    return NULL;
+}
+
+bool ContentFilter::swapIfReady() {
+    if (!_compiling || pthread_mutex_trylock(&_mutex) != 0)
+        return false;
+    
+    FilterAutomaton* ready = _ready;
+    _ready = NULL;
+    pthread_mutex_unlock(&_mutex);
+    
+    if (!ready)
+        return false;
+    
+    pthread_join(_thread, NULL);
+    _compiling = false;
+    _building.clear();
+    
+    delete _active;
+    _active = ready;
+    return true;
+}
+
+FilterAction ContentFilter::check(const std::string& text, std::string& pattern) const {
+    if (!_active) return FILTER_NONE;
+    
+    size_t rule = 0;
+    FilterAction action = _active->match(text, rule);
+    if (action != FILTER_NONE)
+        pattern = _active->getRule(rule).pattern;
+    return action;
+}
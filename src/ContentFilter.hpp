@@ -0,0 +1,81 @@
+#ifndef CONTENTFILTER_HPP
+#define CONTENTFILTER_HPP
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <utility>
+#include <pthread.h>
+#include <regex.h>
+
+enum FilterAction {
+    FILTER_NONE = 0,
+    FILTER_LOG,
+    FILTER_TAG,
+    FILTER_BLOCK
+};
+
+struct FilterRule {
+    std::string pattern;
+    FilterAction action;
+    bool regex;
+};
+
+class FilterAutomaton {
+private:
+    struct State {
+        int rule;
+        FilterAction action;
+    };
+    
+    std::vector<State> _states;
+    std::vector<int> _delta;
+    unsigned char _classes[256];
+    size_t _classCount;
+    std::vector<FilterRule> _rules;
+    std::vector<std::pair<regex_t*, size_t> > _regexes;
+    size_t _rejected;
+    
+    FilterAutomaton(const FilterAutomaton&);
+    FilterAutomaton& operator=(const FilterAutomaton&);
+    
+public:
+    explicit FilterAutomaton(const std::vector<FilterRule>& rules);
+    ~FilterAutomaton();
+    
+    FilterAction match(const std::string& text, size_t& rule) const;
+    const FilterRule& getRule(size_t index) const { return _rules[index]; }
+    size_t getRuleCount() const { return _rules.size(); }
+    size_t getStateCount() const { return _states.size(); }
+    size_t getRejectedCount() const { return _rejected; }
+};
+
+class ContentFilter {
+private:
+    FilterAutomaton* _active;
+    FilterAutomaton* _ready;
+    std::vector<FilterRule> _building;
+    pthread_t _thread;
+    pthread_mutex_t _mutex;
+    bool _compiling;
+    
+    static void* _compile(void* self);
+    
+    ContentFilter(const ContentFilter&);
+    ContentFilter& operator=(const ContentFilter&);
+    
+public:
+    ContentFilter();
+    ~ContentFilter();
+    
+    static bool parseRules(std::istream& input, std::vector<FilterRule>& rules);
+    
+    bool compile(const std::vector<FilterRule>& rules);
+    bool swapIfReady();
+    
+    FilterAction check(const std::string& text, std::string& pattern) const;
+    const FilterAutomaton* getActive() const { return _active; }
+    bool isCompiling() const { return _compiling; }
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "HeavyHitters.hpp"
+
+#include <algorithm>
+
+static unsigned long long keyHash(const std::string& key) {
+    unsigned long long hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < key.length(); i++) {
+        hash ^= static_cast<unsigned char>(key[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+const char* hitterDimensionName(size_t dimension) {
+    static const char* const names[HITTER_DIMENSIONS] = {
+        "sender-messages", "sender-bytes", "host-messages", "host-bytes", "channel-messages", "channel-bytes"
+    };
+    return dimension < HITTER_DIMENSIONS ? names[dimension] : "?";
+}
+
+static bool byEstimate(const HeavyHitter& a, const HeavyHitter& b) {
+    return a.estimate > b.estimate;
+}
+
+HeavyHitters::HeavyHitters(size_t width, size_t depth, size_t capacity, time_t halfLife)
+    : _cells(width * depth, 0), _width(width), _depth(depth), _halfLife(halfLife > 0 ? halfLife : 1),
+      _lastDecay(0), _capacity(capacity) {
+    _top.reserve(capacity);
+}
+
+void HeavyHitters::_decay(time_t now) {
+    if (_lastDecay == 0) {
+        _lastDecay = now;
+        return;
+    }
+    
+    time_t periods = (now - _lastDecay) / _halfLife;
+    if (periods <= 0) return;
+    
+    _lastDecay += periods * _halfLife;
+    if (periods >= 32) {
+        _cells.assign(_cells.size(), 0);
+        _top.clear();
+        return;
+    }
+    for (size_t i = 0; i < _cells.size(); i++)
+        _cells[i] >>= periods;
+    for (size_t i = 0; i < _top.size(); i++)
+        _top[i].estimate >>= periods;
+}
+
+void HeavyHitters::add(const std::string& key, unsigned int weight, time_t now) {
+    _decay(now);
+    
+    unsigned long long hash = keyHash(key);
+    unsigned int first = static_cast<unsigned int>(hash);
+    unsigned int step = static_cast<unsigned int>(hash >> 32) | 1;
+    unsigned int estimate = 0xffffffff;
+    
+    for (size_t row = 0; row < _depth; row++) {
+        unsigned int& cell = _cells[row * _width + (first + row * step) % _width];
+        cell = cell > 0xffffffff - weight ? 0xffffffff : cell + weight;
+        if (cell < estimate)
+            estimate = cell;
+    }
+    
+    size_t lowest = 0;
+    for (size_t i = 0; i < _top.size(); i++) {
+        if (_top[i].hash == hash && _top[i].key == key) {
+            _top[i].estimate = estimate;
+            return;
+        }
+        if (_top[i].estimate < _top[lowest].estimate)
+            lowest = i;
+    }
+    
+    if (_top.size() < _capacity) {
+        HeavyHitter entry;
+        entry.hash = hash;
+        entry.estimate = estimate;
+        _top.push_back(entry);
+        _top.back().key = key;
+    } else if (_capacity && estimate > _top[lowest].estimate) {
+        _top[lowest].key = key;
+        _top[lowest].hash = hash;
+        _top[lowest].estimate = estimate;
+    }
+}
+
+void HeavyHitters::snapshot(std::vector<HeavyHitter>& out, time_t now) {
+    _decay(now);
+    out = _top;
+    std::sort(out.begin(), out.end(), byEstimate);
+}
@@ -0,0 +1,48 @@
+#ifndef HEAVYHITTERS_HPP
+#define HEAVYHITTERS_HPP
+
+#include <string>
+#include <vector>
+#include <ctime>
+
+struct HeavyHitter {
+    std::string key;
+    unsigned long long hash;
+    unsigned int estimate;
+};
+
+enum HitterDimension {
+    HITTER_SENDER_MESSAGES = 0,
+    HITTER_SENDER_BYTES,
+    HITTER_HOST_MESSAGES,
+    HITTER_HOST_BYTES,
+    HITTER_CHANNEL_MESSAGES,
+    HITTER_CHANNEL_BYTES,
+    HITTER_DIMENSIONS
+};
+
+const char* hitterDimensionName(size_t dimension);
+
+class HeavyHitters {
+private:
+    std::vector<unsigned int> _cells;
+    size_t _width;
+    size_t _depth;
+    time_t _halfLife;
+    time_t _lastDecay;
+    std::vector<HeavyHitter> _top;
+    size_t _capacity;
+    
+    void _decay(time_t now);
+    
+public:
+    HeavyHitters(size_t width, size_t depth, size_t capacity, time_t halfLife);
+    
+    void add(const std::string& key, unsigned int weight, time_t now);
+    void snapshot(std::vector<HeavyHitter>& out, time_t now);
+    
+    time_t getHalfLife() const { return _halfLife; }
+    size_t getMemoryUsage() const { return _cells.size() * sizeof(unsigned int) + _capacity * sizeof(HeavyHitter); }
+};
+
+#endif
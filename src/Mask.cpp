@@ -0,0 +1,81 @@
+#include "Mask.hpp"
+
+static char ircToLower(char c) {
+    if (c >= 'A' && c <= 'Z') return c + ('a' - 'A');
+    if (c == '[') return '{';
+    if (c == ']') return '}';
+    if (c == '\\') return '|';
+    if (c == '~') return '^';
+    return c;
+}
+
+std::string ircCasefold(const std::string& str) {
+    std::string folded(str);
+    for (size_t i = 0; i < folded.length(); i++)
+        folded[i] = ircToLower(folded[i]);
+    return folded;
+}
+
+Mask::Mask() : _minLength(0), _literal(true) {}
+
+Mask::Mask(const std::string& pattern) : _pattern(ircCasefold(pattern)) {
+    _compile();
+}
+
+void Mask::_compile() {
+    size_t first = _pattern.find_first_of("*?");
+    size_t last = _pattern.find_last_of("*?");
+    
+    _literal = first == std::string::npos;
+    _prefix = _pattern.substr(0, first);
+    _suffix = _literal ? std::string() : _pattern.substr(last + 1);
+    
+    _minLength = 0;
+    for (size_t i = 0; i < _pattern.length(); i++)
+        if (_pattern[i] != '*')
+            _minLength++;
+}
+
+bool Mask::matches(const std::string& str) const {
+    if (_literal) {
+        if (str.length() != _pattern.length()) return false;
+    } else if (str.length() < _minLength)
+        return false;
+    
+    for (size_t i = 0; i < _prefix.length(); i++)
+        if (ircToLower(str[i]) != _prefix[i]) return false;
+    if (_literal) return true;
+    
+    size_t offset = str.length() - _suffix.length();
+    for (size_t i = 0; i < _suffix.length(); i++)
+        if (ircToLower(str[offset + i]) != _suffix[i]) return false;
+    
+    return _glob(str);
+}
+
+bool Mask::_glob(const std::string& str) const {
+    size_t p = 0, s = 0;
+    size_t starP = std::string::npos, starS = 0;
+    
+    while (s < str.length()) {
+        if (p < _pattern.length() && (_pattern[p] == '?' || _pattern[p] == ircToLower(str[s]))) {
+            p++;
+            s++;
+        } else if (p < _pattern.length() && _pattern[p] == '*') {
+            starP = p++;
+            starS = s;
+        } else if (starP != std::string::npos) {
+            p = starP + 1;
+            s = ++starS;
+        } else
+            return false;
+    }
+    
+    while (p < _pattern.length() && _pattern[p] == '*')
+        p++;
+    return p == _pattern.length();
+}
+
+bool Mask::hasWildcards(const std::string& str) {
+    return str.find_first_of("*?") != std::string::npos;
+}
@@ -0,0 +1,32 @@
+#ifndef MASK_HPP
+#define MASK_HPP
+
+#include <string>
+
+std::string ircCasefold(const std::string& str);
+
+class Mask {
+private:
+    std::string _pattern;
+    std::string _prefix;
+    std::string _suffix;
+    size_t _minLength;
+    bool _literal;
+    
+    void _compile();
+    bool _glob(const std::string& str) const;
+    
+public:
+    Mask();
+    explicit Mask(const std::string& pattern);
+    
+    const std::string& getPattern() const { return _pattern; }
+    const std::string& getPrefix() const { return _prefix; }
+    const std::string& getSuffix() const { return _suffix; }
+    bool isLiteral() const { return _literal; }
+    bool matches(const std::string& str) const;
+    
+    static bool hasWildcards(const std::string& str);
+};
+
+#endif
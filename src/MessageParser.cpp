@@ -0,0 +1,56 @@
+#include "MessageParser.hpp"
+
+#include <cctype>
+
+static bool isSeparator(char c) {
+    return isspace(static_cast<unsigned char>(c)) != 0;
+}
+
+bool splitMessage(const std::string& message, std::string& command, Params& params) {
+    size_t length = message.length();
+    size_t position = 0;
+    bool first = true;
+    
+    params.reserve(4);
+    
+    while (position < length) {
+        while (position < length && isSeparator(message[position]))
+            position++;
+        if (position >= length)
+            break;
+        
+        if (!first && message[position] == ':') {
+            params.push_back(std::string());
+            params.back().assign(message, position + 1, std::string::npos);
+            break;
+        }
+        
+        size_t end = position;
+        while (end < length && !isSeparator(message[end]))
+            end++;
+        
+        if (first)
+            command.assign(message, position, end - position);
+        else {
+            params.push_back(std::string());
+            params.back().assign(message, position, end - position);
+        }
+        first = false;
+        position = end;
+    }
+    
+    return !first;
+}
+
+bool nextListItem(const std::string& list, size_t& position, std::string& item) {
+    if (position > list.length())
+        return false;
+    
+    size_t comma = list.find(',', position);
+    if (comma == std::string::npos)
+        comma = list.length();
+    
+    item.assign(list, position, comma - position);
+    position = comma + 1;
+    return true;
+}
@@ -0,0 +1,11 @@
+#ifndef MESSAGEPARSER_HPP
+#define MESSAGEPARSER_HPP
+
+#include <string>
+
+#include "Arena.hpp"
+
+bool splitMessage(const std::string& message, std::string& command, Params& params);
+bool nextListItem(const std::string& list, size_t& position, std::string& item);
+
+#endif
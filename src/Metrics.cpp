@@ -0,0 +1,82 @@
+#include "Metrics.hpp"
+
+#include <cstring>
+#include <sstream>
+#include <time.h>
+
+const char* const Metrics::_commandNames[Metrics::COMMAND_COUNT] = {
+    "CAP", "CHATHISTORY", "INVITE", "JOIN", "KICK", "LIST", "MODE", "MONITOR", "MOTD",
+    "NAMES", "NICK", "NOTICE", "OPER", "PART", "PASS", "PING", "PONG", "PRIVMSG", "QUIT",
+    "REHASH", "STATS", "TOPIC", "USER", "WHO", "WHOIS", "WHOWAS", "*"
+};
+
+Histogram::Histogram() {
+    reset();
+}
+
+void Histogram::reset() {
+    memset(_buckets, 0, sizeof(_buckets));
+    _count = 0;
+    _sum = 0;
+    _max = 0;
+}
+
+unsigned long long Histogram::bucketUpperBound(unsigned int index) {
+    if (index < SUB_COUNT)
+        return index;
+    unsigned int shift = (index >> SUB_BITS) - 1;
+    unsigned long long mantissa = SUB_COUNT + (index & (SUB_COUNT - 1));
+    return ((mantissa + 1) << shift) - 1;
+}
+
+unsigned long long Histogram::percentile(double quantile) const {
+    if (_count == 0) return 0;
+    
+    unsigned long target = static_cast<unsigned long>(quantile * _count);
+    if (target < 1) target = 1;
+    
+    unsigned long seen = 0;
+    for (unsigned int i = 0; i < BUCKET_COUNT; i++) {
+        seen += _buckets[i];
+        if (seen >= target) {
+            unsigned long long bound = bucketUpperBound(i);
+            return bound < _max ? bound : _max;
+        }
+    }
+    return _max;
+}
+
+std::string Histogram::summarize(const char* unit, unsigned long long divisor) const {
+    std::ostringstream oss;
+    oss << "n=" << _count
+        << " p50=" << percentile(0.5) / divisor << unit
+        << " p99=" << percentile(0.99) / divisor << unit
+        << " p999=" << percentile(0.999) / divisor << unit
+        << " max=" << _max / divisor << unit;
+    return oss.str();
+}
+
+Metrics::Metrics() : _iterations(0), _bytesIn(0), _bytesOut(0), _syscalls(0), _lastIteration(0) {}
+
+size_t Metrics::commandSlot(const std::string& command) {
+    size_t low = 0;
+    size_t high = COMMAND_COUNT - 1;
+    
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        int order = strcmp(command.c_str(), _commandNames[middle]);
+        if (order == 0)
+            return middle;
+        if (order < 0)
+            high = middle;
+        else
+            low = middle + 1;
+    }
+    return COMMAND_COUNT - 1;
+}
+
+unsigned long long Metrics::nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<unsigned long long>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
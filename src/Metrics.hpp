@@ -0,0 +1,108 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <string>
+#include <cstddef>
+
+class Histogram {
+public:
+    static const unsigned int SUB_BITS = 4;
+    static const unsigned int SUB_COUNT = 1 << SUB_BITS;
+    static const unsigned int BUCKET_COUNT = (41 - SUB_BITS) * SUB_COUNT;
+    
+private:
+    unsigned long _buckets[BUCKET_COUNT];
+    unsigned long _count;
+    unsigned long long _sum;
+    unsigned long long _max;
+    
+    static unsigned int _index(unsigned long long value) {
+        if (value < SUB_COUNT)
+            return static_cast<unsigned int>(value);
+        unsigned int exponent = 63 - __builtin_clzll(value);
+        unsigned int index = ((exponent - SUB_BITS + 1) << SUB_BITS)
+                             | static_cast<unsigned int>((value >> (exponent - SUB_BITS)) & (SUB_COUNT - 1));
+        return index < BUCKET_COUNT ? index : BUCKET_COUNT - 1;
+    }
+    
+public:
+    Histogram();
+    
+    void record(unsigned long long value) {
+        _buckets[_index(value)]++;
+        _count++;
+        _sum += value;
+        if (value > _max)
+            _max = value;
+    }
+    
+    void reset();
+    unsigned long long percentile(double quantile) const;
+    unsigned long getCount() const { return _count; }
+    unsigned long long getSum() const { return _sum; }
+    unsigned long long getMax() const { return _max; }
+    std::string summarize(const char* unit, unsigned long long divisor) const;
+    
+    static unsigned long long bucketUpperBound(unsigned int index);
+};
+
+struct CommandMetrics {
+    unsigned long calls;
+    unsigned long long bytes;
+    Histogram latency;
+    
+    CommandMetrics() : calls(0), bytes(0) {}
+};
+
+class Metrics {
+public:
+    static const size_t COMMAND_COUNT = 27;
+    
+private:
+    static const char* const _commandNames[COMMAND_COUNT];
+    
+    CommandMetrics _commands[COMMAND_COUNT];
+    Histogram _iterationTime;
+    Histogram _readyFds;
+    unsigned long _iterations;
+    unsigned long long _bytesIn;
+    unsigned long long _bytesOut;
+    unsigned long long _syscalls;
+    unsigned long long _lastIteration;
+    
+public:
+    Metrics();
+    
+    static size_t commandSlot(const std::string& command);
+    static const char* commandName(size_t slot) { return _commandNames[slot]; }
+    static unsigned long long nowNs();
+    
+    void recordCommand(size_t slot, size_t bytes, unsigned long long elapsedNs) {
+        CommandMetrics& command = _commands[slot];
+        command.calls++;
+        command.bytes += bytes;
+        command.latency.record(elapsedNs);
+    }
+    
+    void recordIteration(unsigned long long elapsedNs, size_t ready) {
+        _iterations++;
+        _lastIteration = elapsedNs;
+        _iterationTime.record(elapsedNs);
+        _readyFds.record(ready);
+    }
+    
+    void addBytesIn(size_t bytes) { _bytesIn += bytes; }
+    void addBytesOut(size_t bytes) { _bytesOut += bytes; }
+    void addSyscall() { _syscalls++; }
+    
+    const CommandMetrics& getCommand(size_t slot) const { return _commands[slot]; }
+    const Histogram& getIterationTime() const { return _iterationTime; }
+    const Histogram& getReadyFds() const { return _readyFds; }
+    unsigned long getIterations() const { return _iterations; }
+    unsigned long long getBytesIn() const { return _bytesIn; }
+    unsigned long long getBytesOut() const { return _bytesOut; }
+    unsigned long long getSyscalls() const { return _syscalls; }
+    unsigned long long getLastIteration() const { return _lastIteration; }
+};
+
+#endif
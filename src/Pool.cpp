@@ -0,0 +1,99 @@
+#include "Pool.hpp"
+
+#include <sys/mman.h>
+
+bool SlabPool::_hugePages = false;
+
+static const size_t SLAB_BYTES = 65536;
+static const size_t HUGE_SLAB_BYTES = 2097152;
+
+static void* mapSlab(size_t bytes, bool hugePages) {
+    if (!hugePages) {
+        void* slab = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return slab == MAP_FAILED ? NULL : slab;
+    }
+    
+    size_t span = bytes + HUGE_SLAB_BYTES;
+    void* region = mmap(NULL, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED)
+        return NULL;
+    
+    char* start = static_cast<char*>(region);
+    char* aligned = reinterpret_cast<char*>((reinterpret_cast<size_t>(start) + HUGE_SLAB_BYTES - 1) & ~(HUGE_SLAB_BYTES - 1));
+    if (aligned > start)
+        munmap(start, aligned - start);
+    if (aligned + bytes < start + span)
+        munmap(aligned + bytes, start + span - (aligned + bytes));
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, bytes, MADV_HUGEPAGE);
+#endif
+    return aligned;
+}
+
+std::vector<SlabPool*>& SlabPool::_registry() {
+    static std::vector<SlabPool*> pools;
+    return pools;
+}
+
+SlabPool::SlabPool(const char* name, size_t objectSize)
+    : _name(name), _slabBytes(0), _free(NULL), _inUse(0), _capacity(0), _allocations(0) {
+    size_t align = sizeof(void*) * 2;
+    _objectSize = objectSize < sizeof(FreeNode) ? sizeof(FreeNode) : objectSize;
+    _objectSize = (_objectSize + align - 1) / align * align;
+    _registry().push_back(this);
+}
+
+SlabPool::~SlabPool() {
+    std::vector<SlabPool*>& pools = _registry();
+    for (size_t i = 0; i < pools.size(); i++) {
+        if (pools[i] == this) {
+            pools.erase(pools.begin() + i);
+            break;
+        }
+    }
+    
+    if (_inUse != 0) return;
+    for (size_t i = 0; i < _slabs.size(); i++)
+        munmap(_slabs[i], _slabBytes);
+}
+
+void SlabPool::_grow() {
+    if (_slabBytes == 0)
+        _slabBytes = _hugePages ? HUGE_SLAB_BYTES : SLAB_BYTES;
+    while (_slabBytes < _objectSize * 16)
+        _slabBytes *= 2;
+    
+    void* slab = mapSlab(_slabBytes, _hugePages);
+    if (!slab)
+        throw std::bad_alloc();
+    
+    _slabs.push_back(slab);
+    size_t count = _slabBytes / _objectSize;
+    char* base = static_cast<char*>(slab);
+    for (size_t i = count; i > 0; i--) {
+        FreeNode* node = reinterpret_cast<FreeNode*>(base + (i - 1) * _objectSize);
+        node->next = _free;
+        _free = node;
+    }
+    _capacity += count;
+}
+
+void* SlabPool::allocate() {
+    if (!_free)
+        _grow();
+    
+    FreeNode* node = _free;
+    _free = node->next;
+    _inUse++;
+    _allocations++;
+    return node;
+}
+
+void SlabPool::deallocate(void* ptr) {
+    if (!ptr) return;
+    
+    FreeNode* node = static_cast<FreeNode*>(ptr);
+    node->next = _free;
+    _free = node;
+    _inUse--;
+}
@@ -0,0 +1,112 @@
+#ifndef POOL_HPP
+#define POOL_HPP
+
+#include <cstddef>
+#include <new>
+#include <set>
+#include <vector>
+#include <functional>
+
+class SlabPool {
+private:
+    struct FreeNode {
+        FreeNode* next;
+    };
+    
+    const char* _name;
+    size_t _objectSize;
+    size_t _slabBytes;
+    std::vector<void*> _slabs;
+    FreeNode* _free;
+    size_t _inUse;
+    size_t _capacity;
+    size_t _allocations;
+    
+    void _grow();
+    
+    static bool _hugePages;
+    static std::vector<SlabPool*>& _registry();
+    
+    SlabPool(const SlabPool&);
+    SlabPool& operator=(const SlabPool&);
+    
+public:
+    SlabPool(const char* name, size_t objectSize);
+    ~SlabPool();
+    
+    void* allocate();
+    void deallocate(void* ptr);
+    
+    const char* getName() const { return _name; }
+    size_t getObjectSize() const { return _objectSize; }
+    size_t getSlabCount() const { return _slabs.size(); }
+    size_t getSlabBytes() const { return _slabBytes; }
+    size_t getInUse() const { return _inUse; }
+    size_t getCapacity() const { return _capacity; }
+    size_t getAllocations() const { return _allocations; }
+    
+    static void setHugePages(bool enabled) { _hugePages = enabled; }
+    static bool isUsingHugePages() { return _hugePages; }
+    static const std::vector<SlabPool*>& getPools() { return _registry(); }
+};
+
+template <typename T>
+class PoolAllocator {
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+    
+    template <typename U>
+    struct rebind {
+        typedef PoolAllocator<U> other;
+    };
+    
+    PoolAllocator() {}
+    PoolAllocator(const PoolAllocator&) {}
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) {}
+    
+    pointer address(reference value) const { return &value; }
+    const_pointer address(const_reference value) const { return &value; }
+    
+    pointer allocate(size_type count, const void* = 0) {
+        if (count == 1)
+            return static_cast<pointer>(pool().allocate());
+        return static_cast<pointer>(::operator new(count * sizeof(T)));
+    }
+    
+    void deallocate(pointer ptr, size_type count) {
+        if (count == 1)
+            pool().deallocate(ptr);
+        else
+            ::operator delete(ptr);
+    }
+    
+    size_type max_size() const { return static_cast<size_type>(-1) / sizeof(T); }
+    void construct(pointer ptr, const T& value) { new (ptr) T(value); }
+    void destroy(pointer ptr) { ptr->~T(); }
+    
+    static SlabPool& pool() {
+        static SlabPool nodes("set-node", sizeof(T));
+        return nodes;
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) { return true; }
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) { return false; }
+
+class Client;
+class Channel;
+
+typedef std::set<Client*, std::less<Client*>, PoolAllocator<Client*> > ClientSet;
+typedef std::set<Channel*, std::less<Channel*>, PoolAllocator<Channel*> > ChannelSet;
+
+#endif
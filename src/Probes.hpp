@@ -0,0 +1,17 @@
+#ifndef PROBES_HPP
+#define PROBES_HPP
+
+#ifdef IRCSERV_USDT
+# include <sys/sdt.h>
+# define IRC_PROBE1(name, a) DTRACE_PROBE1(ircserv, name, a)
+# define IRC_PROBE2(name, a, b) DTRACE_PROBE2(ircserv, name, a, b)
+# define IRC_PROBE3(name, a, b, c) DTRACE_PROBE3(ircserv, name, a, b, c)
+# define IRC_PROBE4(name, a, b, c, d) DTRACE_PROBE4(ircserv, name, a, b, c, d)
+#else
+# define IRC_PROBE1(name, a) do {} while (0)
+# define IRC_PROBE2(name, a, b) do {} while (0)
+# define IRC_PROBE3(name, a, b, c) do {} while (0)
+# define IRC_PROBE4(name, a, b, c, d) do {} while (0)
+#endif
+
+#endif
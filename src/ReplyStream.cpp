@@ -0,0 +1,213 @@
+#include "ReplyStream.hpp"
+#include "Server.hpp"
+#include "Client.hpp"
+#include "Channel.hpp"
+#include "ChannelHistory.hpp"
+
+ListFilter::ListFilter()
+    : minUsers(1), maxUsers(static_cast<size_t>(-1)), createdAfter(0),
+      createdBefore(0), topicAfter(0), topicBefore(0) {}
+
+static bool parseMinutes(const std::string& value, long& minutes) {
+    if (value.empty() || value.length() > 9) return false;
+    
+    for (size_t i = 0; i < value.length(); i++)
+        if (!isdigit(value[i])) return false;
+    
+    minutes = strtol(value.c_str(), NULL, 10);
+    return true;
+}
+
+void ListFilter::parse(const std::string& item, time_t now) {
+    long value;
+    
+    if ((item[0] == '>' || item[0] == '<') && parseMinutes(item.substr(1), value)) {
+        if (item[0] == '>')
+            minUsers = std::max(minUsers, static_cast<size_t>(value) + 1);
+        else
+            maxUsers = std::min(maxUsers, static_cast<size_t>(value));
+        return;
+    }
+    
+    if (item.length() > 2 && (item[0] == 'C' || item[0] == 'T') && (item[1] == '>' || item[1] == '<')
+        && parseMinutes(item.substr(2), value)) {
+        time_t boundary = now - static_cast<time_t>(value) * 60;
+        time_t& after = item[0] == 'C' ? createdAfter : topicAfter;
+        time_t& before = item[0] == 'C' ? createdBefore : topicBefore;
+        
+        if (item[1] == '<')
+            after = std::max(after, boundary);
+        else if (before == 0 || boundary < before)
+            before = boundary;
+        return;
+    }
+    
+    if (item[0] == '!' && item.length() > 1) {
+        excludes.push_back(Mask(item.substr(1)));
+        return;
+    }
+    
+    masks.push_back(Mask(item));
+}
+
+bool ListFilter::matches(Channel* channel) const {
+    if (createdAfter && channel->getCreationTime() <= createdAfter) return false;
+    if (createdBefore && channel->getCreationTime() >= createdBefore) return false;
+    
+    if (topicAfter || topicBefore) {
+        if (channel->getTopic().empty()) return false;
+        if (topicAfter && channel->getTopicSetTime() <= topicAfter) return false;
+        if (topicBefore && channel->getTopicSetTime() >= topicBefore) return false;
+    }
+    
+    for (size_t i = 0; i < excludes.size(); i++)
+        if (excludes[i].matches(channel->getName())) return false;
+    
+    if (masks.empty()) return true;
+    for (size_t i = 0; i < masks.size(); i++)
+        if (masks[i].matches(channel->getName())) return true;
+    return false;
+}
+
+ListStream::ListStream(const ListFilter& filter)
+    : _filter(filter), _cursor(filter.maxUsers, "") {}
+
+bool ListStream::resume(Server& server, Client* client, size_t budget) {
+    const std::set<std::pair<size_t, std::string> >& index = server._channelsByUsers;
+    size_t emitted = 0;
+    bool finished = false;
+    
+    for (size_t steps = 0; steps < budget * 16 && emitted < budget; steps++) {
+        if (client->isSendQueueAboveWatermark())
+            return false;
+        
+        std::set<std::pair<size_t, std::string> >::const_iterator it = index.lower_bound(_cursor);
+        if (it == index.begin()) {
+            finished = true;
+            break;
+        }
+        --it;
+        _cursor = *it;
+        
+        if (it->first < _filter.minUsers) {
+            finished = true;
+            break;
+        }
+        
+        Channel* channel = server.getChannel(it->second);
+        if (!channel || (channel->isSecret() && !channel->hasClient(client)))
+            continue;
+        
+        if (_filter.matches(channel)) {
+            server._sendListReply(client, channel);
+            emitted++;
+        }
+    }
+    
+    if (!finished)
+        return false;
+    
+    server._sendNumericReply(client, RPL_LISTEND, ":End of /LIST");
+    return true;
+}
+
+NamesStream::NamesStream(const std::vector<std::string>& channels, const std::string& endTarget)
+    : _channels(channels.begin(), channels.end()), _endTarget(endTarget), _heldIndex(0) {}
+
+bool NamesStream::resume(Server& server, Client* client, size_t budget) {
+    size_t emitted = 0;
+    
+    while (true) {
+        while (_heldIndex < _held.size()) {
+            if (emitted >= budget || client->isSendQueueAboveWatermark())
+                return false;
+            server._sendNumericReply(client, RPL_NAMREPLY, "= " + _current + " :" + _held[_heldIndex++]);
+            emitted++;
+        }
+        _held.clear();
+        _heldIndex = 0;
+        
+        if (_channels.empty())
+            break;
+        if (emitted >= budget || client->isSendQueueAboveWatermark())
+            return false;
+        
+        _current = _channels.front();
+        _channels.pop_front();
+        
+        Channel* channel = server.getChannel(_current);
+        if (!channel || (channel->isSecret() && !channel->hasClient(client)))
+            continue;
+        
+        const std::vector<std::string>& lines = channel->getNamesLines(server._namesLineLength(_current));
+        size_t i = 0;
+        for (; i < lines.size() && emitted < budget && !client->isSendQueueAboveWatermark(); i++, emitted++)
+            server._sendNumericReply(client, RPL_NAMREPLY, "= " + _current + " :" + lines[i]);
+        
+        if (i < lines.size()) {
+            _held.assign(lines.begin() + i, lines.end());
+            return false;
+        }
+    }
+    
+    server._sendNumericReply(client, RPL_ENDOFNAMES, _endTarget + " :End of /NAMES list");
+    return true;
+}
+
+WhoStream::WhoStream(const std::string& channel, const std::string& mask,
+                     const std::string& fields, const std::string& token)
+    : _channel(channel), _mask(mask), _fields(fields), _token(token), _cursor(NULL), _started(false) {}
+
+bool WhoStream::resume(Server& server, Client* client, size_t budget) {
+    Channel* channel = server.getChannel(_channel);
+    
+    if (channel && channel->hasClient(client)) {
+        const ClientSet& members = channel->getClients();
+        ClientSet::const_iterator it = _started ? members.upper_bound(_cursor) : members.begin();
+        
+        for (size_t emitted = 0; it != members.end(); ++it, ++emitted) {
+            if (emitted >= budget || client->isSendQueueAboveWatermark())
+                return false;
+            server._sendWhoReply(client, channel, *it, _fields, _token);
+            _cursor = *it;
+            _started = true;
+        }
+    }
+    
+    server._sendNumericReply(client, RPL_ENDOFWHO, _mask + " :End of /WHO list");
+    return true;
+}
+
+HistoryStream::HistoryStream(const std::string& channel, const std::string& historyId,
+                             const std::string& batch, unsigned long start, unsigned long end)
+    : _channel(channel), _historyId(historyId), _batch(batch), _cursor(start), _end(end), _started(false) {}
+
+bool HistoryStream::resume(Server& server, Client* client, size_t budget) {
+    if (!_started) {
+        server._sendToClient(client->getFd(), ":" + server._serverName + " BATCH +" + _batch + " chathistory " + _channel);
+        _started = true;
+    }
+    
+    Channel* channel = server.getChannel(_channel);
+    const ChannelHistory* history = channel ? channel->getHistory() : NULL;
+    
+    if (history && history->getId() == _historyId) {
+        if (_cursor < history->getFirstSeq())
+            _cursor = history->getFirstSeq();
+        
+        HistoryEntry entry;
+        for (size_t emitted = 0; _cursor < _end; _cursor++) {
+            if (emitted >= budget || client->isSendQueueAboveWatermark())
+                return false;
+            if (!history->fetch(_cursor, entry))
+                continue;
+            
+            server._sendToClient(client->getFd(), "@batch=" + _batch + ";time=" + ChannelHistory::formatTime(entry.timeMs)
+                                 + ";msgid=" + history->formatMsgid(entry.seq) + " " + entry.line);
+            emitted++;
+        }
+    }
+    
+    server._sendToClient(client->getFd(), ":" + server._serverName + " BATCH -" + _batch);
+    return true;
+}
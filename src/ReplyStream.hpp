@@ -0,0 +1,96 @@
+#ifndef REPLYSTREAM_HPP
+#define REPLYSTREAM_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <utility>
+#include <ctime>
+
+#include "Mask.hpp"
+
+class Client;
+class Channel;
+class Server;
+
+class ReplyStream {
+public:
+    virtual ~ReplyStream() {}
+    
+    virtual bool resume(Server& server, Client* client, size_t budget) = 0;
+};
+
+struct ListFilter {
+    size_t minUsers;
+    size_t maxUsers;
+    time_t createdAfter;
+    time_t createdBefore;
+    time_t topicAfter;
+    time_t topicBefore;
+    std::vector<Mask> masks;
+    std::vector<Mask> excludes;
+    
+    ListFilter();
+    
+    void parse(const std::string& item, time_t now);
+    bool matches(Channel* channel) const;
+};
+
+class ListStream : public ReplyStream {
+private:
+    ListFilter _filter;
+    std::pair<size_t, std::string> _cursor;
+    
+public:
+    explicit ListStream(const ListFilter& filter);
+    
+    virtual bool resume(Server& server, Client* client, size_t budget);
+};
+
+class NamesStream : public ReplyStream {
+private:
+    std::deque<std::string> _channels;
+    std::string _endTarget;
+    std::string _current;
+    std::vector<std::string> _held;
+    size_t _heldIndex;
+    
+public:
+    NamesStream(const std::vector<std::string>& channels, const std::string& endTarget);
+    
+    virtual bool resume(Server& server, Client* client, size_t budget);
+};
+
+class WhoStream : public ReplyStream {
+private:
+    std::string _channel;
+    std::string _mask;
+    std::string _fields;
+    std::string _token;
+    Client* _cursor;
+    bool _started;
+    
+public:
+    WhoStream(const std::string& channel, const std::string& mask,
+              const std::string& fields, const std::string& token);
+    
+    virtual bool resume(Server& server, Client* client, size_t budget);
+};
+
+class HistoryStream : public ReplyStream {
+private:
+    std::string _channel;
+    std::string _historyId;
+    std::string _batch;
+    unsigned long _cursor;
+    unsigned long _end;
+    bool _started;
+    
+public:
+    HistoryStream(const std::string& channel, const std::string& historyId,
+                  const std::string& batch, unsigned long start, unsigned long end);
+    
+    virtual bool resume(Server& server, Client* client, size_t budget);
+};
+
+#endif
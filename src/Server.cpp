@@ -1,9 +1,15 @@
 #include "Server.hpp"
 #include "Client.hpp"
 #include "Channel.hpp"
+#include "ReplyStream.hpp"
+#include "Mask.hpp"
 #include <new>
+#include <climits>
 
 Server* Server::instance = NULL;
+volatile sig_atomic_t Server::shutdownRequested = 0;
+volatile sig_atomic_t Server::rehashRequested = 0;
+volatile sig_atomic_t Server::traceRequested = 0;
 
 std::string intToString(int value) {
     std::ostringstream oss;
@@ -19,7 +25,14 @@ std::string sizeToString(size_t value) {
 
 Server::Server(int port, const std::string& password) 
     : _port(port), _password(password), _serverSocket(-1), _running(false),
-      _maxClients(100), _totalConnections(0), _currentConnections(0) {
+      _whowas(1024), _hitters(HITTER_DIMENSIONS, HeavyHitters(2048, 4, 10, 60)), _trace(65536), _traceWindowNs(5000000000ULL), _lagThresholdNs(200000000ULL), _lastLagDump(0),
+      _motdPath("ircd.motd"), _burstMotdOffset(0), _burstMotdSplice(0),
+      _maxClients(100), _tickMessageBudget(8), _tickTimeBudgetUs(2000),
+      _channelGracePeriod(0), _streamLineBudget(64), _monitorLimit(100),
+      _historyDirectory(), _auditPath(),
+      _filterPath("filters.conf"), _historyQueryLimit(100), _totalConnections(0), _currentConnections(0), _registrations(0),
+      _channelsReclaimed(0), _fanoutEpoch(0), _joinsCoalesced(0), _lastBufferTrim(0),
+      _auditFailures(0), _lastAuditCheck(0) {
     
     _serverName = "irc.1337.fr";
     _serverVersion = "1.0";
@@ -35,6 +48,8 @@ Server::Server(int port, const std::string& password)
     instance = this;
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
+    signal(SIGHUP, rehashHandler);
+    signal(SIGUSR1, traceHandler);
     signal(SIGPIPE, SIG_IGN);
     
     _logMessage("INFO", "IRC Server initialized");
@@ -46,15 +61,43 @@ Server::~Server() {
 
 void Server::signalHandler(int signum) {
     (void)signum;
-    if (instance) {
-        std::cout << "\n" << YELLOW << "Signal received. Shutting down..." << RESET << std::endl;
-        instance->shutdown();
-    }
+    shutdownRequested = 1;
+}
+
+void Server::rehashHandler(int signum) {
+    (void)signum;
+    rehashRequested = 1;
+}
+
+void Server::traceHandler(int signum) {
+    (void)signum;
+    traceRequested = 1;
 }
 
 void Server::start() {
     try {
         _setupSocket();
+        if (!_historyDirectory.empty() && mkdir(_historyDirectory.c_str(), 0700) == -1 && errno != EEXIST) {
+            _logMessage("WARNING", "History spill disabled: " + std::string(strerror(errno)));
+            _historyDirectory.clear();
+        }
+        if (!_auditPath.empty() && !_audit.start(_auditPath))
+            _logMessage("WARNING", "Audit log disabled: cannot open " + _auditPath);
+        reloadFilters();
+        if (!reloadMotd())
+            _renderBurst();
+        if (!_metricsAddress.empty()) {
+            if (_admin.open(_metricsAddress)) {
+                struct pollfd adminPollFd;
+                adminPollFd.fd = _admin.getFd();
+                adminPollFd.events = POLLIN;
+                adminPollFd.revents = 0;
+                _pollFds.push_back(adminPollFd);
+                _logMessage("INFO", "Metrics listening on " + _metricsAddress);
+            } else {
+                _logMessage("WARNING", "Metrics disabled: cannot listen on " + _metricsAddress);
+            }
+        }
         _running = true;
         
         std::cout << BOLD << GREEN << "╔══════════════════════════════════╗" << std::endl;
@@ -63,8 +106,27 @@ void Server::start() {
         
         _logMessage("INFO", "Server listening on port " + intToString(_port));
         
+        bool streamsRunnable = false;
+        
         while (_running) {
-            int pollResult = poll(_pollFds.data(), _pollFds.size(), 100);
+            if (shutdownRequested) {
+                std::cout << "\n" << YELLOW << "Signal received. Shutting down..." << RESET << std::endl;
+                shutdown();
+                break;
+            }
+            if (rehashRequested) {
+                rehashRequested = 0;
+                rehash();
+            }
+            if (traceRequested) {
+                traceRequested = 0;
+                dumpTrace("signal");
+            }
+            
+            int timeout = (_readyClients.empty() && !streamsRunnable) ? 100 : 0;
+            unsigned long long pollStart = Metrics::nowNs();
+            int pollResult = poll(_pollFds.data(), _pollFds.size(), timeout);
+            _metrics.addSyscall();
             
             if (pollResult == -1) {
                 if (errno == EINTR) continue;
@@ -72,14 +134,17 @@ void Server::start() {
                 break;
             }
             
-            if (pollResult == 0) {
-                _cleanupEmptyChannels();
-                continue;
-            }
+            unsigned long long iterationStart = Metrics::nowNs();
+            _trace.record("poll", pollStart, iterationStart - pollStart);
             
             for (size_t i = 0; i < _pollFds.size() && _running; ++i) {
                 if (_pollFds[i].revents == 0) continue;
                 
+                if (_pollFds[i].fd == _admin.getFd() || _admin.owns(_pollFds[i].fd)) {
+                    _handleAdminEvent(_pollFds[i].fd, _pollFds[i].revents);
+                    continue;
+                }
+                
                 if (_pollFds[i].revents & POLLIN) {
                     if (_pollFds[i].fd == _serverSocket)
                         _acceptNewClient();
@@ -87,11 +152,35 @@ void Server::start() {
                         _handleClientData(_pollFds[i].fd);
                 }
                 
+                if ((_pollFds[i].revents & POLLOUT) && _pollFds[i].fd != _serverSocket)
+                    _handleClientWrite(_pollFds[i].fd);
+                
                 if (_pollFds[i].revents & (POLLHUP | POLLERR | POLLNVAL)) {
                     if (_pollFds[i].fd != _serverSocket)
                         _disconnectClient(_pollFds[i].fd, "Connection error");
                 }
             }
+            
+            _processReadyClients();
+            streamsRunnable = _pumpStreams();
+            _flushJoinBursts();
+            _reapDisconnects();
+            _reapChannels();
+            _audit.handoff();
+            _checkAudit();
+            _checkTraceWriter();
+            Arena::tick().reset();
+            _trimBuffers();
+            _expireAdminConnections();
+            if (_filter.swapIfReady())
+                _logMessage("INFO", "Content filter loaded: " + sizeToString(_filter.getActive()->getRuleCount())
+                            + " rules, " + sizeToString(_filter.getActive()->getRejectedCount()) + " rejected");
+            
+            unsigned long long elapsed = Metrics::nowNs() - iterationStart;
+            _trace.record("iteration", iterationStart, elapsed);
+            _metrics.recordIteration(elapsed, pollResult);
+            if (elapsed > _lagThresholdNs)
+                _checkLag(elapsed);
         }
     } catch (const std::exception& e) {
         _logMessage("FATAL", "Server error: " + std::string(e.what()));
@@ -118,10 +207,13 @@ void Server::shutdown() {
     }
     _clients.clear();
     
-    std::map<std::string, Channel*> channelsCopy = _channels;
-    for (std::map<std::string, Channel*>::iterator it = channelsCopy.begin(); it != channelsCopy.end(); ++it)
+    ChannelIndex channelsCopy = _channels;
+    for (ChannelIndex::iterator it = channelsCopy.begin(); it != channelsCopy.end(); ++it)
         delete it->second;
     _channels.clear();
+    _channelsByUsers.clear();
+    _streamingClients.clear();
+    _pendingDisconnects.clear();
     
     if (_serverSocket != -1) {
         close(_serverSocket);
@@ -129,6 +221,13 @@ void Server::shutdown() {
     }
     
     _pollFds.clear();
+    _admin.close();
+    
+    if (_audit.isStarted()) {
+        _audit.stop();
+        _logMessage("INFO", "Audit log closed: " + sizeToString(_audit.getWritten()) + " written, "
+                    + sizeToString(_audit.getDropped()) + " dropped, " + sizeToString(_audit.getDelayed()) + " delayed");
+    }
     
     std::cout << GREEN << "Server shutdown complete." << RESET << std::endl;
     _logMessage("INFO", "Server shutdown completed");
@@ -174,10 +273,13 @@ void Server::_setupSocket() {
 }
 
 void Server::_acceptNewClient() {
+    TraceScope scope(_trace, "accept");
+    
     struct sockaddr_in clientAddr;
     socklen_t clientLen = sizeof(clientAddr);
     
     int clientFd = accept(_serverSocket, (struct sockaddr*)&clientAddr, &clientLen);
+    _metrics.addSyscall();
     if (clientFd == -1) {
         if (errno != EWOULDBLOCK && errno != EAGAIN)
             _logMessage("WARNING", "Failed to accept connection");
@@ -199,6 +301,7 @@ void Server::_acceptNewClient() {
     Client* client = new Client(clientFd, this);
     std::string hostname = inet_ntoa(clientAddr.sin_addr);
     client->setHostname(hostname);
+    IRC_PROBE2(accept, clientFd, client->getHostname().c_str());
     
     _clients[clientFd] = client;
     _totalConnections++;
@@ -215,13 +318,21 @@ void Server::_acceptNewClient() {
 }
 
 void Server::_handleClientData(int clientFd) {
+    TraceScope scope(_trace, "read");
+    
     std::map<int, Client*>::iterator it = _clients.find(clientFd);
     if (it == _clients.end()) return;
     
     Client* client = it->second;
     char buffer[512];
     
-    ssize_t bytesRead = recv(clientFd, buffer, sizeof(buffer) - 1, 0);
+    if (client->isBacklogFull()) {
+        _updateReadGate(client);
+        return;
+    }
+    
+    ssize_t bytesRead = recv(clientFd, buffer, sizeof(buffer), 0);
+    _metrics.addSyscall();
     
     if (bytesRead <= 0) {
         if (bytesRead == 0)
@@ -231,19 +342,124 @@ void Server::_handleClientData(int clientFd) {
         return;
     }
     
-    buffer[bytesRead] = '\0';
-    client->appendToBuffer(std::string(buffer));
+    _metrics.addBytesIn(bytesRead);
+    client->appendToBuffer(buffer, bytesRead);
     
     std::vector<std::string> messages = client->extractMessages();
-    for (size_t i = 0; i < messages.size(); i++) {
-        if (!messages[i].empty()) {
-            _processMessage(client, messages[i]);
-            if (_clients.find(clientFd) == _clients.end())
-                return; 
+    for (size_t i = 0; i < messages.size(); i++)
+        if (!messages[i].empty())
+            client->queueMessage(messages[i]);
+    
+    _updateReadGate(client);
+    if (client->getStream() ? client->hasPriorityMessages() : client->hasPendingMessages())
+        _scheduleClient(client);
+}
+
+void Server::_handleClientWrite(int clientFd) {
+    TraceScope scope(_trace, "write");
+    
+    std::map<int, Client*>::iterator it = _clients.find(clientFd);
+    if (it != _clients.end())
+        _flushClient(it->second);
+}
+
+void Server::_scheduleClient(Client* client) {
+    if (client->isScheduled()) return;
+    
+    client->setScheduled(true);
+    _readyClients.push_back(client->getFd());
+}
+
+void Server::_processReadyClients() {
+    TraceScope scope(_trace, "processReadyClients");
+    
+    size_t rounds = _readyClients.size();
+    
+    while (rounds-- > 0 && _running) {
+        int clientFd = _readyClients.front();
+        _readyClients.pop_front();
+        
+        std::map<int, Client*>::iterator it = _clients.find(clientFd);
+        if (it == _clients.end()) continue;
+        
+        Client* client = it->second;
+        client->setScheduled(false);
+        if (client->isClosing()) continue;
+        
+        struct timeval start, now;
+        gettimeofday(&start, NULL);
+        
+        std::string message;
+        size_t served = 0;
+        bool gone = false;
+        
+        while (served < _tickMessageBudget) {
+            if (client->getStream() ? !client->popPriorityMessage(message) : !client->popMessage(message))
+                break;
+            
+            _processMessage(client, message);
+            if (_clients.find(clientFd) == _clients.end()) {
+                gone = true;
+                break;
+            }
+            served++;
+            
+            gettimeofday(&now, NULL);
+            long elapsedUs = (now.tv_sec - start.tv_sec) * 1000000L + (now.tv_usec - start.tv_usec);
+            if (_tickTimeBudgetUs > 0 && elapsedUs >= _tickTimeBudgetUs)
+                break;
         }
+        
+        if (gone) continue;
+        
+        _updateReadGate(client);
+        if (client->getStream() ? client->hasPriorityMessages() : client->hasPendingMessages())
+            _scheduleClient(client);
     }
 }
 
+void Server::_startStream(Client* client, ReplyStream* stream) {
+    if (!client->getStream() && !client->isSendQueueAboveWatermark()
+        && stream->resume(*this, client, _streamLineBudget)) {
+        delete stream;
+        return;
+    }
+    
+    client->pushStream(stream);
+    _streamingClients.insert(client->getFd());
+}
+
+bool Server::_pumpStreams() {
+    TraceScope scope(_trace, "pumpStreams");
+    
+    bool runnable = false;
+    std::vector<int> fds(_streamingClients.begin(), _streamingClients.end());
+    
+    for (size_t i = 0; i < fds.size(); i++) {
+        std::map<int, Client*>::iterator it = _clients.find(fds[i]);
+        if (it == _clients.end() || !it->second->getStream()) {
+            _streamingClients.erase(fds[i]);
+            continue;
+        }
+        
+        Client* client = it->second;
+        if (client->isClosing() || client->isSendQueueAboveWatermark())
+            continue;
+        
+        while (client->getStream() && client->getStream()->resume(*this, client, _streamLineBudget))
+            client->popStream();
+        
+        if (!client->getStream()) {
+            _streamingClients.erase(fds[i]);
+            if (client->hasPendingMessages())
+                _scheduleClient(client);
+        } else if (!client->isSendQueueAboveWatermark())
+            runnable = true;
+    }
+    
+    return runnable;
+}
+
 void Server::_removeClient(int clientFd) {
     _disconnectClient(clientFd, "Connection closed");
 }
@@ -254,14 +470,26 @@ void Server::_disconnectClient(int clientFd, const std::string& reason) {
     
     Client* client = it->second;
     std::string nickname = client->getNickname().empty() ? "*" : client->getNickname();
+    IRC_PROBE3(disconnect, clientFd, nickname.c_str(), reason.c_str());
+    
+    const ChannelSet& joined = client->getChannels();
+    for (ChannelSet::const_iterator chIt = joined.begin(); chIt != joined.end(); ++chIt)
+        _flushJoinBurst(*chIt);
     
-    std::set<Channel*> channels = client->getChannels();
-    for (std::set<Channel*>::iterator chIt = channels.begin(); chIt != channels.end(); ++chIt) {
-        Channel* channel = *chIt;
-        std::string quitMsg = ":" + client->getPrefix() + " QUIT :" + reason;
-        _sendToChannel(channel, quitMsg, client);
-        channel->removeClient(client);
+    _sendToNeighbors(client, ":" + client->getPrefix() + " QUIT :" + reason, false);
+    if (client->isRegistered()) {
+        _whowas.record(client);
+        _notifyMonitors(client, client->getNickname(), false);
     }
+    _clearMonitors(client);
+    
+    ChannelSet channels = client->getChannels();
+    for (ChannelSet::iterator chIt = channels.begin(); chIt != channels.end(); ++chIt)
+        (*chIt)->removeClient(client);
+    
+    if (!client->isClosing())
+        _flushClient(client);
+    _streamingClients.erase(clientFd);
     
     for (std::vector<struct pollfd>::iterator pIt = _pollFds.begin(); pIt != _pollFds.end(); ++pIt) {
         if (pIt->fd == clientFd) {
@@ -276,42 +504,367 @@ void Server::_disconnectClient(int clientFd, const std::string& reason) {
     _currentConnections--;
     
     std::cout << RED << "Client " << nickname << " disconnected: " << reason << RESET << std::endl;
-    _cleanupEmptyChannels();
+}
+
+void Server::_markForDisconnect(Client* client, const std::string& reason) {
+    if (client->isClosing()) return;
+    
+    client->setClosing(true);
+    _pendingDisconnects.push_back(std::make_pair(client->getFd(), reason));
+}
+
+void Server::_reapDisconnects() {
+    TraceScope scope(_trace, "reapDisconnects");
+    
+    std::vector<std::pair<int, std::string> > pending;
+    pending.swap(_pendingDisconnects);
+    
+    for (size_t i = 0; i < pending.size(); i++) {
+        std::map<int, Client*>::iterator it = _clients.find(pending[i].first);
+        if (it != _clients.end() && it->second->isClosing())
+            _disconnectClient(pending[i].first, pending[i].second);
+    }
 }
 
 void Server::_processMessage(Client* client, const std::string& message) {
     if (message.empty() || message.length() > 512) return;
+    IRC_PROBE2(message, client->getFd(), message.length());
     
     if (client->isRegistered())
-        std::cout << BLUE << client->getNickname() << ": " << message << RESET << std::endl;
+        std::cout << BLUE << client->getNickname() << ": "
+                  << (message.compare(0, 5, "OPER ") == 0 ? "OPER ***" : message) << RESET << std::endl;
     
     _parseCommand(client, message);
 }
 
-std::vector<std::string> Server::_splitMessage(const std::string& message) {
-    std::vector<std::string> tokens;
-    std::istringstream iss(message);
-    std::string token;
-    bool foundColon = false;
+void Server::_sendToClient(int clientFd, const std::string& message) {
+    if (message.empty()) return;
     
-    while (iss >> token) {
-        if (!foundColon && token[0] == ':' && !tokens.empty()) {
-            std::string rest;
-            std::getline(iss, rest);
-            token = token.substr(1) + rest;
-            foundColon = true;
+    _sendFramed(clientFd, message + "\r\n");
+}
+
+void Server::_sendFramed(int clientFd, const std::string& framed) {
+    std::map<int, Client*>::iterator it = _clients.find(clientFd);
+    if (it == _clients.end()) {
+        send(clientFd, framed.c_str(), framed.length(), MSG_NOSIGNAL);
+        return;
+    }
+    _deliver(it->second, framed);
+}
+
+void Server::_deliver(Client* client, const std::string& framed) {
+    _deliver(client, framed.data(), framed.length());
+}
+
+void Server::_deliver(Client* client, const char* framed, size_t length) {
+    if (client->isClosing()) return;
+    
+    if (client->getSendQueueSize() > 0) {
+        client->queueOutput(framed, length);
+    } else {
+        ssize_t sent = send(client->getFd(), framed, length, MSG_NOSIGNAL);
+        _metrics.addSyscall();
+        IRC_PROBE4(send, client->getFd(), length, sent, sent == -1 ? errno : 0);
+        if (sent == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                _markForDisconnect(client, "Write error");
+                return;
+            }
+            sent = 0;
         }
-        tokens.push_back(token);
+        _metrics.addBytesOut(sent);
+        if (static_cast<size_t>(sent) == length)
+            return;
+        
+        client->queueOutput(framed + sent, length - sent);
+        _setPollOut(client->getFd(), true);
     }
     
-    return tokens;
+    if (client->isSendQueueFull())
+        _markForDisconnect(client, "SendQ exceeded");
 }
 
-void Server::_sendToClient(int clientFd, const std::string& message) {
-    if (message.empty()) return;
+#ifdef IRCSERV_USDT
+static size_t iovecLength(const std::vector<struct iovec>& iov) {
+    size_t length = 0;
+    for (size_t i = 0; i < iov.size(); i++)
+        length += iov[i].iov_len;
+    return length;
+}
+#endif
+
+void Server::_deliverVector(Client* client, const std::vector<struct iovec>& iov) {
+    if (client->isClosing()) return;
+    
+    size_t sent = 0;
+    if (client->getSendQueueSize() == 0 && iov.size() <= IOV_MAX) {
+        ssize_t result = writev(client->getFd(), &iov[0], iov.size());
+        _metrics.addSyscall();
+        IRC_PROBE4(send, client->getFd(), iovecLength(iov), result, result == -1 ? errno : 0);
+        if (result == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                _markForDisconnect(client, "Write error");
+                return;
+            }
+            result = 0;
+        }
+        sent = result;
+        _metrics.addBytesOut(sent);
+    }
+    
+    bool queued = false;
+    for (size_t i = 0; i < iov.size(); i++) {
+        if (sent >= iov[i].iov_len) {
+            sent -= iov[i].iov_len;
+            continue;
+        }
+        client->queueOutput(static_cast<const char*>(iov[i].iov_base) + sent, iov[i].iov_len - sent);
+        sent = 0;
+        queued = true;
+    }
+    
+    if (queued)
+        _setPollOut(client->getFd(), true);
+    if (client->isSendQueueFull())
+        _markForDisconnect(client, "SendQ exceeded");
+}
+
+void Server::_handleAdminEvent(int fd, short revents) {
+    if (fd == _admin.getFd()) {
+        int adminFd = _admin.accept();
+        if (adminFd == -1) return;
+        
+        struct pollfd adminPollFd;
+        adminPollFd.fd = adminFd;
+        adminPollFd.events = POLLIN;
+        adminPollFd.revents = 0;
+        _pollFds.push_back(adminPollFd);
+        return;
+    }
+    
+    AdminEvent event = ADMIN_PENDING;
+    if (revents & POLLIN) {
+        std::string path;
+        event = _admin.read(fd, path);
+        if (event == ADMIN_REQUEST) {
+            if (path == "/metrics") {
+                _renderMetrics(_metricsBody);
+                _admin.respond(fd, 200, "OK", "text/plain; version=0.0.4", _metricsBody);
+            } else if (path == "/trace") {
+                _trace.render(_metricsBody, _traceWindowNs);
+                _admin.respond(fd, 200, "OK", "application/json", _metricsBody);
+            } else {
+                _admin.respond(fd, 404, "Not Found", "text/plain", "not found\n");
+            }
+            event = _admin.write(fd);
+            if (event == ADMIN_PENDING)
+                _setPollOut(fd, true);
+        }
+    } else if (revents & POLLOUT) {
+        event = _admin.write(fd);
+    } else if (revents & (POLLHUP | POLLERR | POLLNVAL)) {
+        event = ADMIN_DONE;
+    }
+    
+    if (event == ADMIN_DONE)
+        _closeAdminConnection(fd);
+}
+
+void Server::_closeAdminConnection(int fd) {
+    for (std::vector<struct pollfd>::iterator pIt = _pollFds.begin(); pIt != _pollFds.end(); ++pIt) {
+        if (pIt->fd == fd) {
+            _pollFds.erase(pIt);
+            break;
+        }
+    }
+    _admin.drop(fd);
+}
+
+void Server::_expireAdminConnections() {
+    int fd;
+    while ((fd = _admin.nextExpired(time(NULL), 10)) != -1)
+        _closeAdminConnection(fd);
+}
+
+void Server::_checkLag(unsigned long long elapsedNs) {
+    _logMessage("WARNING", "Event loop iteration took " + sizeToString(elapsedNs / 1000000) + " ms");
+    
+    time_t now = time(NULL);
+    if (now - _lastLagDump < 10) return;
+    
+    _lastLagDump = now;
+    dumpTrace("lag");
+}
+
+bool Server::dumpTrace(const std::string& reason) {
+    std::string name = "trace-" + sizeToString(time(NULL)) + "-" + reason + ".json";
+    
+    if (!_traceWriter.submit(name, _trace, _traceWindowNs)) {
+        _logMessage("WARNING", "Trace dump skipped: previous dump still being written");
+        return false;
+    }
+    return true;
+}
+
+void Server::_checkTraceWriter() {
+    std::string path;
+    bool written;
+    while (_traceWriter.takeResult(path, written)) {
+        if (written)
+            _logMessage("INFO", "Trace written to " + path);
+        else
+            _logMessage("WARNING", "Cannot write trace to " + path);
+    }
+}
+
+void Server::_renderMetrics(std::string& out) {
+    size_t registered = 0;
+    size_t sendQueued = 0;
+    size_t sendQueueMax = 0;
+    size_t recvQueued = 0;
+    for (std::map<int, Client*>::const_iterator it = _clients.begin(); it != _clients.end(); ++it) {
+        if (it->second->isRegistered())
+            registered++;
+        sendQueued += it->second->getSendQueueSize();
+        recvQueued += it->second->getBufferSize();
+        if (it->second->getSendQueueSize() > sendQueueMax)
+            sendQueueMax = it->second->getSendQueueSize();
+    }
+    
+    out.clear();
+    MetricsWriter writer(out);
+    
+    writer.header("ircserv_uptime_seconds", "gauge", "Seconds since the server started.");
+    writer.sample("ircserv_uptime_seconds", time(NULL) - _startTime);
+    writer.header("ircserv_connections", "gauge", "Open client connections.");
+    writer.sample("ircserv_connections", _clients.size());
+    writer.header("ircserv_connections_total", "counter", "Accepted client connections.");
+    writer.sample("ircserv_connections_total", _totalConnections);
+    writer.header("ircserv_registered_clients", "gauge", "Clients that completed registration.");
+    writer.sample("ircserv_registered_clients", registered);
+    writer.header("ircserv_registrations_total", "counter", "Completed registrations.");
+    writer.sample("ircserv_registrations_total", _registrations);
+    writer.header("ircserv_channels", "gauge", "Existing channels.");
+    writer.sample("ircserv_channels", _channels.size());
+    
+    writer.header("ircserv_commands_total", "counter", "Commands dispatched.");
+    for (size_t i = 0; i < Metrics::COMMAND_COUNT; i++)
+        if (_metrics.getCommand(i).calls)
+            writer.sample("ircserv_commands_total", _metrics.getCommand(i).calls, "command", Metrics::commandName(i));
+    writer.header("ircserv_command_bytes_total", "counter", "Bytes of command lines received.");
+    for (size_t i = 0; i < Metrics::COMMAND_COUNT; i++)
+        if (_metrics.getCommand(i).calls)
+            writer.sample("ircserv_command_bytes_total", _metrics.getCommand(i).bytes, "command", Metrics::commandName(i));
+    writer.header("ircserv_command_duration_seconds", "summary", "Command handler latency.");
+    for (size_t i = 0; i < Metrics::COMMAND_COUNT; i++) {
+        const CommandMetrics& command = _metrics.getCommand(i);
+        if (!command.calls) continue;
+        writer.seconds("ircserv_command_duration_seconds", command.latency.percentile(0.5), "command", Metrics::commandName(i), "0.5");
+        writer.seconds("ircserv_command_duration_seconds", command.latency.percentile(0.99), "command", Metrics::commandName(i), "0.99");
+        writer.seconds("ircserv_command_duration_seconds_sum", command.latency.getSum(), "command", Metrics::commandName(i));
+        writer.sample("ircserv_command_duration_seconds_count", command.latency.getCount(), "command", Metrics::commandName(i));
+    }
+    
+    writer.header("ircserv_sendq_bytes", "gauge", "Bytes waiting in client send queues.");
+    writer.sample("ircserv_sendq_bytes", sendQueued);
+    writer.header("ircserv_sendq_max_bytes", "gauge", "Largest client send queue.");
+    writer.sample("ircserv_sendq_max_bytes", sendQueueMax);
+    writer.header("ircserv_recvq_bytes", "gauge", "Bytes of partial lines in client read buffers.");
+    writer.sample("ircserv_recvq_bytes", recvQueued);
+    
+    const Histogram& iteration = _metrics.getIterationTime();
+    writer.header("ircserv_loop_iteration_seconds", "summary", "Event loop work time per wakeup.");
+    writer.seconds("ircserv_loop_iteration_seconds", iteration.percentile(0.5), NULL, NULL, "0.5");
+    writer.seconds("ircserv_loop_iteration_seconds", iteration.percentile(0.99), NULL, NULL, "0.99");
+    writer.seconds("ircserv_loop_iteration_seconds", iteration.percentile(0.999), NULL, NULL, "0.999");
+    writer.seconds("ircserv_loop_iteration_seconds_sum", iteration.getSum());
+    writer.sample("ircserv_loop_iteration_seconds_count", iteration.getCount());
+    writer.header("ircserv_loop_lag_seconds", "gauge", "Work time of the most recent loop iteration.");
+    writer.seconds("ircserv_loop_lag_seconds", _metrics.getLastIteration());
+    
+    writer.header("ircserv_receive_bytes_total", "counter", "Bytes read from client sockets.");
+    writer.sample("ircserv_receive_bytes_total", _metrics.getBytesIn());
+    writer.header("ircserv_transmit_bytes_total", "counter", "Bytes written to client sockets.");
+    writer.sample("ircserv_transmit_bytes_total", _metrics.getBytesOut());
+    writer.header("ircserv_syscalls_total", "counter", "poll, accept, recv, send and writev calls on the chat path.");
+    writer.sample("ircserv_syscalls_total", _metrics.getSyscalls());
+}
+
+void Server::_flushClient(Client* client) {
+    const Buffer& queue = client->getSendQueue();
+    if (queue.empty()) return;
+    
+    ssize_t sent = send(client->getFd(), queue.data(), queue.size(), MSG_NOSIGNAL);
+    _metrics.addSyscall();
+    IRC_PROBE4(send, client->getFd(), queue.size(), sent, sent == -1 ? errno : 0);
+    if (sent == -1) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            _markForDisconnect(client, "Write error");
+        return;
+    }
+    
+    _metrics.addBytesOut(sent);
+    client->consumeSendQueue(sent);
+    if (client->getSendQueueSize() == 0)
+        _setPollOut(client->getFd(), false);
+}
+
+void Server::_setPollOut(int clientFd, bool enabled) {
+    for (size_t i = 0; i < _pollFds.size(); i++) {
+        if (_pollFds[i].fd != clientFd) continue;
+        
+        if (enabled)
+            _pollFds[i].events |= POLLOUT;
+        else
+            _pollFds[i].events &= ~POLLOUT;
+        return;
+    }
+}
+
+void Server::_setPollIn(int clientFd, bool enabled) {
+    for (size_t i = 0; i < _pollFds.size(); i++) {
+        if (_pollFds[i].fd != clientFd) continue;
+        
+        if (enabled)
+            _pollFds[i].events |= POLLIN;
+        else
+            _pollFds[i].events &= ~POLLIN;
+        return;
+    }
+}
+
+void Server::_updateReadGate(Client* client) {
+    bool paused = client->isBacklogFull();
+    if (paused == client->isReadPaused())
+        return;
+    
+    client->setReadPaused(paused);
+    _setPollIn(client->getFd(), !paused);
+}
+
+size_t Server::_sendToNeighbors(Client* client, const std::string& message, bool includeSelf) {
+    unsigned long epoch = ++_fanoutEpoch;
+    std::string framed = message + "\r\n";
+    size_t sent = 0;
+    
+    client->setFanoutMark(epoch);
+    if (includeSelf) {
+        _deliver(client, framed);
+        sent++;
+    }
+    
+    const ChannelSet& channels = client->getChannels();
+    for (ChannelSet::const_iterator chIt = channels.begin(); chIt != channels.end(); ++chIt) {
+        const ClientSet& members = (*chIt)->getClients();
+        for (ClientSet::const_iterator it = members.begin(); it != members.end(); ++it) {
+            if ((*it)->getFanoutMark() == epoch) continue;
+            (*it)->setFanoutMark(epoch);
+            _deliver(*it, framed);
+            sent++;
+        }
+    }
     
-    std::string fullMessage = message + "\r\n";
-    send(clientFd, fullMessage.c_str(), fullMessage.length(), MSG_NOSIGNAL);
+    return sent;
 }
 
 void Server::_sendNumericReply(Client* client, int code, const std::string& message) {
@@ -364,27 +917,28 @@ Channel* Server::_getOrCreateChannel(const std::string& channelName) {
     if (!channel) {
         channel = new Channel(channelName);
         channel->setServer(this);
-        _channels[channelName] = channel;
+        _channels[channel->getNameHandle()] = channel;
+        _channelsByUsers.insert(std::make_pair(static_cast<size_t>(0), channelName));
         _logMessage("INFO", "Channel created: " + channelName);
     }
     return channel;
 }
 
 Client* Server::getClientByNick(const std::string& nickname) {
-    for (std::map<int, Client*>::iterator it = _clients.begin(); it != _clients.end(); ++it)
-        if (it->second->getNickname() == nickname)
-            return it->second;
-    return NULL;
+    std::map<std::string, Client*>::iterator it = _clientsByNick.find(ircCasefold(nickname));
+    return (it != _clientsByNick.end()) ? it->second : NULL;
 }
 
 Channel* Server::getChannel(const std::string& channelName) {
-    std::map<std::string, Channel*>::iterator it = _channels.find(channelName);
+    InternedString key = InternedString::find(channelName);
+    if (key.empty()) return NULL;
+    ChannelIndex::iterator it = _channels.find(key);
     return (it != _channels.end()) ? it->second : NULL;
 }
 
 std::vector<Channel*> Server::getChannelList() {
     std::vector<Channel*> channels;
-    for (std::map<std::string, Channel*>::iterator it = _channels.begin(); it != _channels.end(); ++it)
+    for (ChannelIndex::iterator it = _channels.begin(); it != _channels.end(); ++it)
         channels.push_back(it->second);
     return channels;
 }
@@ -449,33 +1003,240 @@ bool Server::_rateLimitCheck(Client* client) {
 }
 
 bool Server::_isClientFlooding(Client* client) {
-    return client->getBuffer().length() > 8192;
+    return client->getBufferSize() > 8192;
+}
+
+void Server::scheduleChannelRemoval(Channel* channel) {
+    if (channel)
+        _pendingChannelRemovals.push_back(std::make_pair(channel->getEmptySince(), channel->getName()));
+}
+
+void Server::reindexChannel(Channel* channel, size_t oldCount) {
+    _channelsByUsers.erase(std::make_pair(oldCount, channel->getName()));
+    _channelsByUsers.insert(std::make_pair(channel->getClientCount(), channel->getName()));
+}
+
+static std::string hostIndexKey(const std::string& hostname) {
+    std::string key = ircCasefold(hostname);
+    std::reverse(key.begin(), key.end());
+    return key;
+}
+
+static InternedString userIndexKey(const Client* client) {
+    std::string key = ircCasefold(client->getUsername());
+    return key == client->getUsername() ? client->getUsernameHandle() : InternedString(key);
 }
 
-void Server::_cleanupEmptyChannels() {
-    std::vector<std::string> emptyChannels;
+static void eraseFromIndex(InternedIndex& index, const std::string& key, Client* client) {
+    InternedIndex::iterator it = index.find(InternedString::find(key));
+    if (it == index.end()) return;
     
-    for (std::map<std::string, Channel*>::iterator it = _channels.begin(); it != _channels.end(); ++it)
-        if (it->second->isEmpty())
-            emptyChannels.push_back(it->first);
+    it->second.erase(client);
+    if (it->second.empty())
+        index.erase(it);
+}
+
+void Server::reindexClientHost(Client* client, const std::string& oldHostname) {
+    eraseFromIndex(_clientsByHost, hostIndexKey(oldHostname), client);
+    _clientsByHost[InternedString(hostIndexKey(client->getHostname()))].insert(client);
+}
+
+void Server::reindexClientUser(Client* client, const std::string& oldUsername) {
+    if (!oldUsername.empty())
+        eraseFromIndex(_clientsByUser, ircCasefold(oldUsername), client);
+    _clientsByUser[userIndexKey(client)].insert(client);
+}
+
+void Server::reindexClientNick(Client* client, const std::string& oldNickname) {
+    std::map<std::string, Client*>::iterator it = _clientsByNick.find(ircCasefold(oldNickname));
+    if (it != _clientsByNick.end() && it->second == client)
+        _clientsByNick.erase(it);
+    _clientsByNick[ircCasefold(client->getNickname())] = client;
+}
+
+void Server::unindexClient(Client* client) {
+    std::map<std::string, Client*>::iterator it = _clientsByNick.find(ircCasefold(client->getNickname()));
+    if (it != _clientsByNick.end() && it->second == client)
+        _clientsByNick.erase(it);
+
+    eraseFromIndex(_clientsByHost, hostIndexKey(client->getHostname()), client);
+    _operators.erase(client);
+    if (!client->getUsername().empty())
+        eraseFromIndex(_clientsByUser, ircCasefold(client->getUsername()), client);
+}
+
+void Server::_reapChannels() {
+    TraceScope scope(_trace, "reapChannels");
+    
+    if (_pendingChannelRemovals.empty()) return;
     
-    for (size_t i = 0; i < emptyChannels.size(); i++) {
-        std::map<std::string, Channel*>::iterator it = _channels.find(emptyChannels[i]);
-        if (it != _channels.end()) {
-            delete it->second;
+    time_t now = time(NULL);
+    
+    while (!_pendingChannelRemovals.empty()) {
+        const std::pair<time_t, std::string>& entry = _pendingChannelRemovals.front();
+        ChannelIndex::iterator it = _channels.find(InternedString::find(entry.second));
+        
+        if (it != _channels.end() && it->second->isEmpty() && it->second->getEmptySince() == entry.first) {
+            if (now - entry.first < _channelGracePeriod)
+                break;
+            
+            Channel* channel = it->second;
             _channels.erase(it);
-            _logMessage("INFO", "Empty channel removed: " + emptyChannels[i]);
+            _channelsByUsers.erase(std::make_pair(static_cast<size_t>(0), entry.second));
+            delete channel;
+            _channelsReclaimed++;
         }
+        _pendingChannelRemovals.pop_front();
     }
 }
 
+void Server::_trimBuffers() {
+    time_t now = time(NULL);
+    if (now - _lastBufferTrim < 5) return;
+    
+    _lastBufferTrim = now;
+    BufferPool::instance().trim();
+}
+
+void Server::_checkAudit() {
+    time_t now = time(NULL);
+    if (!_audit.isStarted() || now == _lastAuditCheck) return;
+    
+    _lastAuditCheck = now;
+    size_t failures = _audit.getFailures();
+    if (failures == _auditFailures) return;
+    
+    _auditFailures = failures;
+    _logMessage("ERROR", "Audit log write failed: " + std::string(strerror(_audit.getLastError()))
+                + " (" + sizeToString(_audit.getDropped()) + " records dropped so far)");
+}
+
 void Server::_sendToChannel(Channel* channel, const std::string& message, Client* exclude) {
     if (!channel) return;
     
-    const std::set<Client*>& clients = channel->getClients();
-    for (std::set<Client*>::const_iterator it = clients.begin(); it != clients.end(); ++it)
+    _flushJoinBurst(channel);
+    
+    ArenaString framed;
+    framed.reserve(message.length() + 2);
+    framed.append(message.data(), message.length()).append("\r\n");
+    _sendFramedToChannel(channel, framed.data(), framed.length(), exclude);
+}
+
+void Server::_sendFramedToChannel(Channel* channel, const char* framed, size_t length, Client* exclude) {
+    _flushJoinBurst(channel);
+    
+    const ClientSet& clients = channel->getClients();
+    for (ClientSet::const_iterator it = clients.begin(); it != clients.end(); ++it)
         if (*it != exclude)
-            _sendToClient((*it)->getFd(), message);
+            _deliver(*it, framed, length);
+    
+    time_t now = time(NULL);
+    _hitters[HITTER_CHANNEL_MESSAGES].add(channel->getName(), 1, now);
+    _hitters[HITTER_CHANNEL_BYTES].add(channel->getName(), length * clients.size(), now);
+    IRC_PROBE3(broadcast, channel->getName().c_str(), clients.size() - (exclude != NULL), length);
+}
+
+void Server::_auditChannel(Channel* channel, const std::string& message) {
+    if (channel->isAudited())
+        _audit.record(channel->getName(), message);
+}
+
+bool Server::reloadFilters() {
+    if (_filterPath.empty()) return false;
+    
+    std::ifstream input(_filterPath.c_str());
+    if (!input) return false;
+    
+    if (_filter.isCompiling()) {
+        _logMessage("WARNING", "Content filter not reloaded: previous compile still running");
+        return true;
+    }
+    
+    std::vector<FilterRule> rules;
+    if (!ContentFilter::parseRules(input, rules))
+        _logMessage("WARNING", "Ignoring malformed lines in " + _filterPath);
+    if (!_filter.compile(rules))
+        _logMessage("WARNING", "Content filter not reloaded: cannot start compile thread");
+    return true;
+}
+
+bool Server::_passesFilter(Client* client, const std::string& command, const std::string& target, const std::string& text) {
+    std::string pattern;
+    FilterAction action = _filter.check(text, pattern);
+    if (action == FILTER_NONE) return true;
+    
+    std::string note = client->getNickname() + " -> " + target + " matched \"" + pattern + "\"";
+    
+    if (action == FILTER_TAG) {
+        for (ClientSet::iterator it = _operators.begin(); it != _operators.end(); ++it)
+            _sendToClient((*it)->getFd(), ":" + _serverName + " NOTICE " + (*it)->getNickname() + " :*** Filter: " + note);
+    }
+    
+    if (action == FILTER_BLOCK) {
+        _logMessage("FILTER", "Blocked " + note);
+        if (command != "NOTICE")
+            _sendNumericReply(client, ERR_CANNOTSENDTOCHAN, target + " :Message blocked by content filter");
+        return false;
+    }
+    
+    _logMessage("FILTER", note);
+    return true;
+}
+
+void Server::_queueJoinBurst(Channel* channel, Client* client) {
+    if (!channel->hasPendingJoins())
+        _joinBursts.push_back(channel);
+    channel->addPendingJoin(client);
+    _joinsCoalesced++;
+}
+
+void Server::_flushJoinBurst(Channel* channel) {
+    if (!channel->hasPendingJoins()) return;
+    
+    std::vector<Client*> joiners = channel->getPendingJoins();
+    channel->clearPendingJoins();
+    
+    unsigned long epoch = ++_fanoutEpoch;
+    std::vector<size_t> offsets(1, 0);
+    std::string burst;
+    for (size_t i = 0; i < joiners.size(); i++) {
+        joiners[i]->setFanoutMark(epoch);
+        burst += ":" + joiners[i]->getPrefix() + " JOIN :" + channel->getName() + "\r\n";
+        offsets.push_back(burst.length());
+    }
+    
+    const ClientSet& members = channel->getClients();
+    for (ClientSet::const_iterator it = members.begin(); it != members.end(); ++it)
+        if ((*it)->getFanoutMark() != epoch)
+            _deliver(*it, burst);
+    
+    for (size_t i = 0; i < joiners.size(); i++) {
+        _deliver(joiners[i], burst.data() + offsets[i], offsets[i + 1] - offsets[i]);
+        _sendJoinReplies(joiners[i], channel);
+    }
+}
+
+void Server::_flushJoinBursts() {
+    TraceScope scope(_trace, "flushJoinBursts");
+    
+    for (size_t i = 0; i < _joinBursts.size(); i++)
+        _flushJoinBurst(_joinBursts[i]);
+    _joinBursts.clear();
+}
+
+void Server::_sendJoinReplies(Client* client, Channel* channel) {
+    const std::string& channelName = channel->getName();
+    
+    if (!channel->getTopic().empty())
+        _sendNumericReply(client, RPL_TOPIC, channelName + " :" + channel->getTopic());
+    
+    _startStream(client, new NamesStream(std::vector<std::string>(1, channelName), channelName));
+}
+
+size_t Server::_namesLineLength(const std::string& channelName) const {
+    static const size_t nickLength = 9;
+    size_t overhead = 1 + _serverName.length() + 5 + nickLength + 3 + channelName.length() + 2 + 2;
+    return overhead < 512 ? 512 - overhead : 1;
 }
 
 void Server::sendToClient(int clientFd, const std::string& message) {
@@ -483,32 +1244,118 @@ void Server::sendToClient(int clientFd, const std::string& message) {
 }
 
 void Server::_sendWelcomeSequence(Client* client) {
-    std::string nick = client->getNickname();
-    std::string user = client->getUsername();
-    std::string host = client->getHostname();
+    const std::string& nick = client->getNickname();
     
-    _sendNumericReply(client, RPL_WELCOME, ":Welcome to " + _serverName + " " + nick + "!" + user + "@" + host);
-    _sendNumericReply(client, RPL_YOURHOST, ":Your host is " + _serverName + ", running version " + _serverVersion);
-    _sendNumericReply(client, RPL_CREATED, ":This server was created " + _creationDate);
-    _sendNumericReply(client, RPL_MYINFO, _serverName + " " + _serverVersion + " o itkol");
-    
-    _sendMotd(client);
+    std::string welcome = ":" + _serverName + " 001 " + nick + " :Welcome to " + _serverName + " "
+                          + nick + "!" + client->getUsername() + "@" + client->getHostname() + "\r\n";
+    _sendRendered(client, welcome, 0, 0);
+    _registrations++;
+    IRC_PROBE2(registered, client->getFd(), nick.c_str());
+    _notifyMonitors(client, nick, true);
     
     std::cout << GREEN << "User " << nick << " registered successfully" << RESET << std::endl;
 }
 
 void Server::_sendMotd(Client* client) {
+    _sendRendered(client, "", _burstMotdOffset, _burstMotdSplice);
+}
+
+void Server::_renderBurst() {
+    _burst.clear();
+    _burstSplices.clear();
+    
+    _appendRendered(RPL_YOURHOST, ":Your host is " + _serverName + ", running version " + _serverVersion);
+    _appendRendered(RPL_CREATED, ":This server was created " + _creationDate);
+    _appendRendered(RPL_MYINFO, _serverName + " " + _serverVersion + " o AbeIiklot");
+    _appendRendered(RPL_ISUPPORT, "CASEMAPPING=rfc1459 CHANTYPES=#& CHANMODES=beI,k,l,Ait "
+                    "PREFIX=(o)@ NICKLEN=9 CHANNELLEN=50 TOPICLEN=307 ELIST=CMNTU "
+                    "MONITOR=" + sizeToString(_monitorLimit) + " WHOX CHATHISTORY=" + sizeToString(_historyQueryLimit) +
+                    " MSGREFTYPES=msgid,timestamp :are supported by this server");
+    
+    _burstMotdOffset = _burst.length();
+    _burstMotdSplice = _burstSplices.size();
+    
     if (_motd.empty()) {
-        _sendNumericReply(client, ERR_NOMOTD, ":MOTD File is missing");
+        _appendRendered(ERR_NOMOTD, ":MOTD File is missing");
         return;
     }
     
-    _sendNumericReply(client, RPL_MOTDSTART, ":- " + _serverName + " Message of the day -");
+    _appendRendered(RPL_MOTDSTART, ":- " + _serverName + " Message of the day -");
     
     std::istringstream iss(_motd);
     std::string line;
     while (std::getline(iss, line))
-        _sendNumericReply(client, RPL_MOTD, ":- " + line);
+        _appendRendered(RPL_MOTD, ":- " + line);
+    
+    _appendRendered(RPL_ENDOFMOTD, ":End of /MOTD command");
+}
+
+void Server::_appendRendered(int code, const std::string& message) {
+    std::ostringstream oss;
+    oss << ":" << _serverName << " " << std::setfill('0') << std::setw(3) << code << " ";
+    
+    _burst += oss.str();
+    _burstSplices.push_back(_burst.length());
+    _burst += " " + message + "\r\n";
+}
+
+void Server::_sendRendered(Client* client, const std::string& head, size_t offset, size_t splice) {
+    const std::string nick = client->getNickname().empty() ? "*" : client->getNickname();
+    std::vector<struct iovec> iov;
+    struct iovec part;
     
-    _sendNumericReply(client, RPL_ENDOFMOTD, ":End of /MOTD command");
+    if (!head.empty()) {
+        part.iov_base = const_cast<char*>(head.data());
+        part.iov_len = head.length();
+        iov.push_back(part);
+    }
+    
+    for (; splice < _burstSplices.size(); splice++) {
+        part.iov_base = const_cast<char*>(_burst.data() + offset);
+        part.iov_len = _burstSplices[splice] - offset;
+        iov.push_back(part);
+        part.iov_base = const_cast<char*>(nick.data());
+        part.iov_len = nick.length();
+        iov.push_back(part);
+        offset = _burstSplices[splice];
+    }
+    
+    part.iov_base = const_cast<char*>(_burst.data() + offset);
+    part.iov_len = _burst.length() - offset;
+    iov.push_back(part);
+    
+    _deliverVector(client, iov);
+}
+
+void Server::setMotd(const std::string& motd) {
+    _motd = motd;
+    _renderBurst();
+}
+
+bool Server::reloadMotd() {
+    if (_motdPath.empty()) return false;
+    
+    std::ifstream input(_motdPath.c_str());
+    if (!input) return false;
+    
+    std::string motd;
+    std::string line;
+    size_t lines = 0;
+    while (std::getline(input, line)) {
+        if (!line.empty() && line[line.length() - 1] == '\r')
+            line.erase(line.length() - 1);
+        motd += (lines++ ? "\n" : "") + line;
+    }
+    
+    setMotd(motd);
+    _logMessage("INFO", "MOTD loaded: " + sizeToString(lines) + " lines from " + _motdPath);
+    return true;
+}
+
+void Server::rehash() {
+    _logMessage("INFO", "Rehashing configuration");
+    if (!reloadMotd())
+        _logMessage("WARNING", "MOTD not reloaded: cannot open " + _motdPath);
+    if (!reloadFilters())
+        _logMessage("WARNING", "Content filter not reloaded: cannot open " + _filterPath);
 }
\ No newline at end of file
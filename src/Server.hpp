@@ -6,8 +6,10 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <deque>
 #include <algorithm>
 #include <sstream>
+#include <fstream>
 #include <cstring>
 #include <cerrno>
 #include <cstdlib>
@@ -23,9 +25,26 @@
 #include <fcntl.h>
 #include <poll.h>
 #include <signal.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "WhowasHistory.hpp"
+#include "AuditLog.hpp"
+#include "ContentFilter.hpp"
+#include "SpamDetector.hpp"
+#include "Pool.hpp"
+#include "Arena.hpp"
+#include "Metrics.hpp"
+#include "AdminListener.hpp"
+#include "Trace.hpp"
+#include "Probes.hpp"
+#include "HeavyHitters.hpp"
 
 class Client;
 class Channel;
+class ReplyStream;
+class Mask;
 
 #define RESET   "\033[0m"
 #define RED     "\033[31m"
@@ -37,7 +56,16 @@ class Channel;
 #define WHITE   "\033[37m"
 #define BOLD    "\033[1m"
 
+typedef std::map<std::string, ClientSet > ClientIndex;
+typedef std::map<InternedString, ClientSet> InternedIndex;
+typedef std::map<InternedString, Channel*> ChannelIndex;
+
 class Server {
+    friend class ListStream;
+    friend class NamesStream;
+    friend class WhoStream;
+    friend class HistoryStream;
+    
 private:
     int _port;
     std::string _password;
@@ -46,50 +74,124 @@ private:
     
     std::vector<struct pollfd> _pollFds;
     std::map<int, Client*> _clients;
-    std::map<std::string, Channel*> _channels;
+    ChannelIndex _channels;
+    std::deque<int> _readyClients;
+    std::deque<std::pair<time_t, std::string> > _pendingChannelRemovals;
+    std::vector<Channel*> _joinBursts;
+    std::set<std::pair<size_t, std::string> > _channelsByUsers;
+    InternedIndex _clientsByHost;
+    InternedIndex _clientsByUser;
+    std::map<std::string, Client*> _clientsByNick;
+    ClientIndex _monitors;
+    ClientSet _operators;
+    std::set<int> _streamingClients;
+    std::vector<std::pair<int, std::string> > _pendingDisconnects;
+    WhowasHistory _whowas;
+    AuditLog _audit;
+    ContentFilter _filter;
+    SpamDetector _spam;
+    std::vector<HeavyHitters> _hitters;
+    Metrics _metrics;
+    AdminListener _admin;
+    std::string _metricsAddress;
+    std::string _metricsBody;
+    TraceRing _trace;
+    TraceWriter _traceWriter;
+    unsigned long long _traceWindowNs;
+    unsigned long long _lagThresholdNs;
+    time_t _lastLagDump;
     
     std::string _serverName;
     std::string _serverVersion;
     std::string _creationDate;
     std::string _motd;
+    std::string _motdPath;
+    std::string _operPassword;
+    std::string _burst;
+    std::vector<size_t> _burstSplices;
+    size_t _burstMotdOffset;
+    size_t _burstMotdSplice;
     size_t _maxClients;
+    size_t _tickMessageBudget;
+    long _tickTimeBudgetUs;
+    time_t _channelGracePeriod;
+    size_t _streamLineBudget;
+    size_t _monitorLimit;
+    std::string _historyDirectory;
+    std::string _auditPath;
+    std::string _filterPath;
+    size_t _historyQueryLimit;
     
     size_t _totalConnections;
     size_t _currentConnections;
+    size_t _registrations;
+    size_t _channelsReclaimed;
+    unsigned long _fanoutEpoch;
+    size_t _joinsCoalesced;
     time_t _startTime;
+    time_t _lastBufferTrim;
+    size_t _auditFailures;
+    time_t _lastAuditCheck;
     
     void _setupSocket();
     void _acceptNewClient();
     void _handleClientData(int clientFd);
+    void _handleClientWrite(int clientFd);
+    void _handleAdminEvent(int fd, short revents);
+    void _closeAdminConnection(int fd);
+    void _expireAdminConnections();
+    void _renderMetrics(std::string& out);
+    void _checkLag(unsigned long long elapsedNs);
     void _removeClient(int clientFd);
+    void _scheduleClient(Client* client);
+    void _processReadyClients();
+    void _startStream(Client* client, ReplyStream* stream);
+    bool _pumpStreams();
     void _processMessage(Client* client, const std::string& message);
     void _parseCommand(Client* client, const std::string& command);
+    void _dispatchCommand(Client* client, const std::string& cmd, const Params& params);
     
-    void _handlePass(Client* client, const std::vector<std::string>& params);
-    void _handleNick(Client* client, const std::vector<std::string>& params);
-    void _handleUser(Client* client, const std::vector<std::string>& params);
-    void _handleJoin(Client* client, const std::vector<std::string>& params);
-    void _handlePart(Client* client, const std::vector<std::string>& params);
-    void _handlePrivmsg(Client* client, const std::vector<std::string>& params);
-    void _handleQuit(Client* client, const std::vector<std::string>& params);
-    void _handlePing(Client* client, const std::vector<std::string>& params);
-    void _handleKick(Client* client, const std::vector<std::string>& params);
-    void _handleInvite(Client* client, const std::vector<std::string>& params);
-    void _handleTopic(Client* client, const std::vector<std::string>& params);
-    void _handleMode(Client* client, const std::vector<std::string>& params);
-    void _handleWho(Client* client, const std::vector<std::string>& params);
-    void _handleWhois(Client* client, const std::vector<std::string>& params);
-    void _handleList(Client* client, const std::vector<std::string>& params);
-    void _handleNames(Client* client, const std::vector<std::string>& params);
-    void _handleMotd(Client* client, const std::vector<std::string>& params);
-    void _handleAdmin(Client* client, const std::vector<std::string>& params);
-    void _handleTime(Client* client, const std::vector<std::string>& params);
-    void _handleVersion(Client* client, const std::vector<std::string>& params);
-    void _handleInfo(Client* client, const std::vector<std::string>& params);
-    void _handleStats(Client* client, const std::vector<std::string>& params);
+    void _handlePass(Client* client, const Params& params);
+    void _handleNick(Client* client, const Params& params);
+    void _handleUser(Client* client, const Params& params);
+    void _handleJoin(Client* client, const Params& params);
+    void _handlePart(Client* client, const Params& params);
+    void _handlePrivmsg(Client* client, const std::string& command, const Params& params);
+    void _handleQuit(Client* client, const Params& params);
+    void _handlePing(Client* client, const Params& params);
+    void _handleKick(Client* client, const Params& params);
+    void _handleInvite(Client* client, const Params& params);
+    void _handleTopic(Client* client, const Params& params);
+    void _handleMode(Client* client, const Params& params);
+    void _handleWho(Client* client, const Params& params);
+    void _handleWhois(Client* client, const Params& params);
+    void _handleList(Client* client, const Params& params);
+    void _handleNames(Client* client, const Params& params);
+    void _handleMotd(Client* client, const Params& params);
+    void _handleAdmin(Client* client, const Params& params);
+    void _handleTime(Client* client, const Params& params);
+    void _handleVersion(Client* client, const Params& params);
+    void _handleInfo(Client* client, const Params& params);
+    void _handleStats(Client* client, const Params& params);
+    void _handleOper(Client* client, const Params& params);
+    void _handleRehash(Client* client, const Params& params);
+    void _handleMonitor(Client* client, const Params& params);
+    void _handleWhowas(Client* client, const Params& params);
+    void _handleChathistory(Client* client, const Params& params);
     
-    std::vector<std::string> _splitMessage(const std::string& message);
     void _sendToClient(int clientFd, const std::string& message);
+    void _sendFramed(int clientFd, const std::string& framed);
+    void _deliver(Client* client, const std::string& framed);
+    void _deliver(Client* client, const char* framed, size_t length);
+    void _deliverVector(Client* client, const std::vector<struct iovec>& iov);
+    void _flushClient(Client* client);
+    void _setPollOut(int clientFd, bool enabled);
+    void _setPollIn(int clientFd, bool enabled);
+    void _updateReadGate(Client* client);
+    void _auditChannel(Channel* channel, const std::string& message);
+    bool _passesFilter(Client* client, const std::string& command, const std::string& target, const std::string& text);
+    size_t _sendToNeighbors(Client* client, const std::string& message, bool includeSelf);
+    void _sendFramedToChannel(Channel* channel, const char* framed, size_t length, Client* exclude);
     void _sendToChannel(Channel* channel, const std::string& message, Client* exclude = NULL);
     bool _isValidNickname(const std::string& nickname);
     bool _isValidChannelName(const std::string& channelName);
@@ -104,15 +206,36 @@ private:
     void _sendNumericReply(Client* client, int code, const std::string& message);
     void _sendWelcomeSequence(Client* client);
     void _sendMotd(Client* client);
+    void _renderBurst();
+    void _appendRendered(int code, const std::string& message);
+    void _sendRendered(Client* client, const std::string& head, size_t offset, size_t splice);
     void _sendChannelModes(Client* client, Channel* channel);
-    void _sendWhoReply(Client* client, Channel* channel, Client* target);
+    void _sendMaskList(Client* client, Channel* channel, char type);
+    void _sendMonitorStatus(Client* client, const std::vector<std::string>& nicks);
+    void _notifyMonitors(Client* target, const std::string& nickname, bool online);
+    void _clearMonitors(Client* client);
+    void _sendWhoReply(Client* client, Channel* channel, Client* target,
+                       const std::string& fields = "", const std::string& token = "");
+    void _collectWhoMatches(const std::string& mask, const std::string& matchFields, bool operOnly,
+                            std::vector<Client*>& results);
+    bool _whoMatches(Client* target, const Mask& mask, const std::string& matchFields, bool operOnly);
     void _sendWhoisReply(Client* client, Client* target);
     void _sendListReply(Client* client, Channel* channel);
-    void _sendStatsReply(Client* client);
+    void _sendStatsReply(Client* client, const std::string& query);
     
-    void _cleanupEmptyChannels();
+    void _reapChannels();
+    void _trimBuffers();
+    void _checkAudit();
+    void _checkTraceWriter();
+    void _queueJoinBurst(Channel* channel, Client* client);
+    void _flushJoinBurst(Channel* channel);
+    void _flushJoinBursts();
+    void _sendJoinReplies(Client* client, Channel* channel);
+    size_t _namesLineLength(const std::string& channelName) const;
     bool _isClientFlooding(Client* client);
     void _disconnectClient(int clientFd, const std::string& reason);
+    void _markForDisconnect(Client* client, const std::string& reason);
+    void _reapDisconnects();
     
 public:
     Server(int port, const std::string& password);
@@ -124,11 +247,14 @@ public:
     
     const std::string& getPassword() const { return _password; }
     const std::string& getServerName() const { return _serverName; }
+    const std::string& getHistoryDirectory() const { return _historyDirectory; }
     const std::string& getServerVersion() const { return _serverVersion; }
     const std::string& getMotd() const { return _motd; }
     size_t getMaxClients() const { return _maxClients; }
     size_t getTotalConnections() const { return _totalConnections; }
     size_t getCurrentConnections() const { return _currentConnections; }
+    size_t getChannelsReclaimed() const { return _channelsReclaimed; }
+    size_t getJoinsCoalesced() const { return _joinsCoalesced; }
     time_t getStartTime() const { return _startTime; }
     
     Client* getClientByNick(const std::string& nickname);
@@ -136,15 +262,50 @@ public:
     std::vector<Channel*> getChannelList();
     std::vector<Client*> getClientList();
     
-    void setMotd(const std::string& motd) { _motd = motd; }
+    void setMotd(const std::string& motd);
+    void setMotdPath(const std::string& path) { _motdPath = path; }
+    bool reloadMotd();
+    void setOperPassword(const std::string& password) { _operPassword = password; }
+    void rehash();
     void setMaxClients(size_t maxClients) { _maxClients = maxClients; }
+    void setTickMessageBudget(size_t budget) { _tickMessageBudget = budget ? budget : 1; }
+    void setTickTimeBudgetUs(long budgetUs) { _tickTimeBudgetUs = budgetUs; }
+    void setChannelGracePeriod(time_t seconds) { _channelGracePeriod = seconds; }
+    void setMonitorLimit(size_t limit) { _monitorLimit = limit; }
+    void setWhowasCapacity(size_t capacity) { _whowas.resize(capacity); }
+    void setHistoryDirectory(const std::string& directory) { _historyDirectory = directory; }
+    void setSpamSourceThresholds(unsigned int throttle, unsigned int drop) { _spam.setSourceThresholds(throttle, drop); }
+    void setSpamGlobalThresholds(unsigned int throttle, unsigned int drop) { _spam.setGlobalThresholds(throttle, drop); }
+    void setFilterPath(const std::string& path) { _filterPath = path; }
+    bool reloadFilters();
+    void setAuditPath(const std::string& path) { _auditPath = path; }
+    void setAuditFsyncIntervalMs(long intervalMs) { _audit.setFsyncIntervalMs(intervalMs); }
+    void setAuditRotateBytes(size_t bytes) { _audit.setRotateBytes(bytes); }
+    void setHistoryQueryLimit(size_t limit) { _historyQueryLimit = limit ? limit : 1; }
+    void setMetricsAddress(const std::string& address) { _metricsAddress = address; }
+    void setLagThresholdMs(unsigned long milliseconds) { _lagThresholdNs = milliseconds * 1000000ULL; }
+    void setTraceWindowMs(unsigned long milliseconds) { _traceWindowNs = milliseconds * 1000000ULL; }
+    void setTraceDirectory(const std::string& directory) { _traceWriter.setDirectory(directory); }
+    void setTraceMaxFiles(size_t maxFiles) { _traceWriter.setMaxFiles(maxFiles); }
+    bool dumpTrace(const std::string& reason);
     
     bool isRunning() const { return _running; }
     bool isValidPassword(const std::string& password) const;
     void sendToClient(int clientFd, const std::string& message);
+    void scheduleChannelRemoval(Channel* channel);
+    void reindexChannel(Channel* channel, size_t oldCount);
+    void reindexClientHost(Client* client, const std::string& oldHostname);
+    void reindexClientUser(Client* client, const std::string& oldUsername);
+    void reindexClientNick(Client* client, const std::string& oldNickname);
+    void unindexClient(Client* client);
     
     static Server* instance;
+    static volatile sig_atomic_t shutdownRequested;
+    static volatile sig_atomic_t rehashRequested;
+    static volatile sig_atomic_t traceRequested;
     static void signalHandler(int signum);
+    static void rehashHandler(int signum);
+    static void traceHandler(int signum);
 };
 
 #define RPL_WELCOME 001
@@ -152,6 +313,11 @@ public:
 #define RPL_CREATED 003
 #define RPL_MYINFO 004
 #define RPL_BOUNCE 005
+#define RPL_ISUPPORT 005
+#define RPL_STATSCOMMANDS 212
+#define RPL_ENDOFSTATS 219
+#define RPL_STATSUPTIME 242
+#define RPL_STATSDEBUG 249
 #define RPL_USERHOST 302
 #define RPL_ISON 303
 #define RPL_AWAY 301
@@ -180,6 +346,7 @@ public:
 #define RPL_ENDOFEXCEPTLIST 349
 #define RPL_VERSION 351
 #define RPL_WHOREPLY 352
+#define RPL_WHOSPCRPL 354
 #define RPL_ENDOFWHO 315
 #define RPL_NAMREPLY 353
 #define RPL_ENDOFNAMES 366
@@ -257,4 +424,10 @@ public:
 #define ERR_UMODEUNKNOWNFLAG 501
 #define ERR_USERSDONTMATCH 502
 
+#define RPL_MONONLINE 730
+#define RPL_MONOFFLINE 731
+#define RPL_MONLIST 732
+#define RPL_ENDOFMONLIST 733
+#define ERR_MONLISTFULL 734
+
 #endif
\ No newline at end of file
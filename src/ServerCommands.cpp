@@ -1,19 +1,31 @@
 #include "Server.hpp"
 #include "Client.hpp"
 #include "Channel.hpp"
+#include "ReplyStream.hpp"
+#include "Mask.hpp"
+#include "ChannelHistory.hpp"
+#include "MessageParser.hpp"
 
 extern std::string intToString(int value);
 extern std::string sizeToString(size_t value);
 
 void Server::_parseCommand(Client* client, const std::string& command) {
-    std::vector<std::string> tokens = _splitMessage(command);
-    if (tokens.empty()) return;
+    std::string cmd;
+    Params params;
+    if (!splitMessage(command, cmd, params)) return;
     
-    std::string cmd = tokens[0];
     std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::toupper);
     
-    std::vector<std::string> params(tokens.begin() + 1, tokens.end());
-    
+    size_t slot = Metrics::commandSlot(cmd);
+    unsigned long long started = Metrics::nowNs();
+    _dispatchCommand(client, cmd, params);
+    unsigned long long elapsed = Metrics::nowNs() - started;
+    _metrics.recordCommand(slot, command.length() + 2, elapsed);
+    _trace.record(Metrics::commandName(slot), started, elapsed);
+    IRC_PROBE2(command, Metrics::commandName(slot), elapsed);
+}
+
+void Server::_dispatchCommand(Client* client, const std::string& cmd, const Params& params) {
     if (cmd == "CAP") {
         if (!params.empty() && params[0] == "LS")
             _sendToClient(client->getFd(), "CAP * LS :");
@@ -31,7 +43,7 @@ void Server::_parseCommand(Client* client, const std::string& command) {
     else if (cmd == "PART")
         _handlePart(client, params);
     else if (cmd == "PRIVMSG" || cmd == "NOTICE")
-        _handlePrivmsg(client, params);
+        _handlePrivmsg(client, cmd, params);
     else if (cmd == "QUIT")
         _handleQuit(client, params);
     else if (cmd == "PING")
@@ -56,11 +68,23 @@ void Server::_parseCommand(Client* client, const std::string& command) {
         _handleNames(client, params);
     else if (cmd == "MOTD")
         _handleMotd(client, params);
+    else if (cmd == "MONITOR")
+        _handleMonitor(client, params);
+    else if (cmd == "WHOWAS")
+        _handleWhowas(client, params);
+    else if (cmd == "CHATHISTORY")
+        _handleChathistory(client, params);
+    else if (cmd == "STATS")
+        _handleStats(client, params);
+    else if (cmd == "OPER")
+        _handleOper(client, params);
+    else if (cmd == "REHASH")
+        _handleRehash(client, params);
     else if (client->isRegistered())
         _sendNumericReply(client, ERR_UNKNOWNCOMMAND, cmd + " :Unknown command");
 }
 
-void Server::_handlePass(Client* client, const std::vector<std::string>& params) {
+void Server::_handlePass(Client* client, const Params& params) {
     if (client->isRegistered()) {
         _sendNumericReply(client, ERR_ALREADYREGISTRED, ":You may not reregister");
         return;
@@ -83,7 +107,7 @@ void Server::_handlePass(Client* client, const std::vector<std::string>& params)
         _sendWelcomeSequence(client);
 }
 
-void Server::_handleNick(Client* client, const std::vector<std::string>& params) {
+void Server::_handleNick(Client* client, const Params& params) {
     if (!client->hasPasswordProvided() && !_password.empty()) {
         _sendNumericReply(client, ERR_NOTREGISTERED, ":Password required");
         return;
@@ -107,26 +131,26 @@ void Server::_handleNick(Client* client, const std::vector<std::string>& params)
         return;
     }
     
+    const ChannelSet& joined = client->getChannels();
+    for (ChannelSet::const_iterator it = joined.begin(); it != joined.end(); ++it)
+        _flushJoinBurst(*it);
+    
     std::string oldNick = client->getNickname();
+    if (client->isRegistered())
+        _whowas.record(client);
     client->setNickname(newNick);
     
     if (client->isRegistered()) {
         std::string nickMsg = ":" + oldNick + "!" + client->getUsername() + "@" + client->getHostname() + " NICK :" + newNick;
         
-        _sendToClient(client->getFd(), nickMsg);
-        
-        std::set<Client*> notifiedClients;
-        notifiedClients.insert(client);
+        const ChannelSet& channels = client->getChannels();
+        for (ChannelSet::const_iterator it = channels.begin(); it != channels.end(); ++it)
+            (*it)->invalidateNames();
         
-        std::set<Channel*> channels = client->getChannels();
-        for (std::set<Channel*>::iterator it = channels.begin(); it != channels.end(); ++it) {
-            const std::set<Client*>& channelClients = (*it)->getClients();
-            for (std::set<Client*>::const_iterator cIt = channelClients.begin(); cIt != channelClients.end(); ++cIt) {
-                if (notifiedClients.find(*cIt) == notifiedClients.end()) {
-                    _sendToClient((*cIt)->getFd(), nickMsg);
-                    notifiedClients.insert(*cIt);
-                }
-            }
+        _sendToNeighbors(client, nickMsg, true);
+        if (ircCasefold(oldNick) != ircCasefold(newNick)) {
+            _notifyMonitors(client, oldNick, false);
+            _notifyMonitors(client, newNick, true);
         }
         
         _logMessage("INFO", "Nick change: " + oldNick + " -> " + newNick);
@@ -137,7 +161,7 @@ void Server::_handleNick(Client* client, const std::vector<std::string>& params)
     }
 }
 
-void Server::_handleUser(Client* client, const std::vector<std::string>& params) {
+void Server::_handleUser(Client* client, const Params& params) {
     if (!client->hasPasswordProvided() && !_password.empty()) {
         _sendNumericReply(client, ERR_NOTREGISTERED, ":Password required");
         return;
@@ -161,7 +185,7 @@ void Server::_handleUser(Client* client, const std::vector<std::string>& params)
         _sendWelcomeSequence(client);
 }
 
-void Server::_handleJoin(Client* client, const std::vector<std::string>& params) {
+void Server::_handleJoin(Client* client, const Params& params) {
     if (!client->isRegistered()) {
         _sendNumericReply(client, ERR_NOTREGISTERED, ":You have not registered");
         return;
@@ -173,8 +197,8 @@ void Server::_handleJoin(Client* client, const std::vector<std::string>& params)
     }
     
     if (params[0] == "0") {
-        std::set<Channel*> channels = client->getChannels();
-        for (std::set<Channel*>::iterator it = channels.begin(); it != channels.end(); ++it) {
+        ChannelSet channels = client->getChannels();
+        for (ChannelSet::iterator it = channels.begin(); it != channels.end(); ++it) {
             std::string partMsg = ":" + client->getPrefix() + " PART " + (*it)->getName() + " :Leaving all channels";
             _sendToChannel(*it, partMsg);
             client->leaveChannel(*it);
@@ -208,29 +232,31 @@ void Server::_handleJoin(Client* client, const std::vector<std::string>& params)
         if (!channel->canJoin(client, key)) {
             if (channel->getUserLimit() > 0 && channel->getClientCount() >= static_cast<size_t>(channel->getUserLimit()))
                 _sendNumericReply(client, ERR_CHANNELISFULL, channelName + " :Cannot join channel (+l)");
-            else if (channel->isInviteOnly() && !channel->isInvited(client))
+            else if (channel->isInviteOnly() && !channel->isInvited(client) && !channel->isInviteExempt(client))
                 _sendNumericReply(client, ERR_INVITEONLYCHAN, channelName + " :Cannot join channel (+i)");
             else if (channel->hasKey() && key != channel->getKey())
                 _sendNumericReply(client, ERR_BADCHANNELKEY, channelName + " :Cannot join channel (+k)");
             else if (channel->isBanned(client))
                 _sendNumericReply(client, ERR_BANNEDFROMCHAN, channelName + " :Cannot join channel (+b)");
+            if (channel->isEmpty())
+                scheduleChannelRemoval(channel);
             continue;
         }
         
         client->joinChannel(channel);
         
+        if (channel->recordJoin(time(NULL))) {
+            _queueJoinBurst(channel, client);
+            continue;
+        }
+        
         std::string joinMsg = ":" + client->getPrefix() + " JOIN :" + channelName;
         _sendToChannel(channel, joinMsg);
-        
-        if (!channel->getTopic().empty())
-            _sendNumericReply(client, RPL_TOPIC, channelName + " :" + channel->getTopic());
-        
-        _sendNumericReply(client, RPL_NAMREPLY, "= " + channelName + " :" + channel->getNamesReply());
-        _sendNumericReply(client, RPL_ENDOFNAMES, channelName + " :End of /NAMES list");
+        _sendJoinReplies(client, channel);
     }
 }
 
-void Server::_handlePart(Client* client, const std::vector<std::string>& params) {
+void Server::_handlePart(Client* client, const Params& params) {
     if (!client->isRegistered()) {
         _sendNumericReply(client, ERR_NOTREGISTERED, ":You have not registered");
         return;
@@ -267,7 +293,7 @@ void Server::_handlePart(Client* client, const std::vector<std::string>& params)
     }
 }
 
-void Server::_handlePrivmsg(Client* client, const std::vector<std::string>& params) {
+void Server::_handlePrivmsg(Client* client, const std::string& command, const Params& params) {
     if (!client->isRegistered()) {
         _sendNumericReply(client, ERR_NOTREGISTERED, ":You have not registered");
         return;
@@ -283,11 +309,34 @@ void Server::_handlePrivmsg(Client* client, const std::vector<std::string>& para
         return;
     }
     
-    std::istringstream targetStream(params[0]);
+    size_t targetCount = std::count(params[0].begin(), params[0].end(), ',') + 1;
+    time_t now = time(NULL);
+    _hitters[HITTER_SENDER_MESSAGES].add(client->getNickname(), 1, now);
+    _hitters[HITTER_SENDER_BYTES].add(client->getNickname(), params[1].length() * targetCount, now);
+    _hitters[HITTER_HOST_MESSAGES].add(client->getHostname(), 1, now);
+    _hitters[HITTER_HOST_BYTES].add(client->getHostname(), params[1].length() * targetCount, now);
+    
+    SpamVerdict verdict = _spam.check(client->getRecentMessages(), params[1], targetCount, now);
+    if (verdict == SPAM_DROP) {
+        _logMessage("SPAM", "Dropped repeated message from " + client->getNickname() + " to " + params[0]);
+        return;
+    }
+    
+    const std::string& text = params[1];
+    std::string prefix = client->getPrefix();
     std::string target;
+    size_t position = 0;
+    bool delivered = false;
     
-    while (std::getline(targetStream, target, ',')) {
+    while (nextListItem(params[0], position, target)) {
         if (target.empty()) continue;
+        if (verdict == SPAM_THROTTLE && delivered) break;
+        if (!_passesFilter(client, command, target, text)) continue;
+        
+        ArenaString framed;
+        framed.reserve(prefix.length() + target.length() + text.length() + 16);
+        framed.append(":").append(prefix.data(), prefix.length()).append(" PRIVMSG ")
+              .append(target.data(), target.length()).append(" :").append(text.data(), text.length()).append("\r\n");
         
         if (target[0] == '#' || target[0] == '&') {
             Channel* channel = getChannel(target);
@@ -301,8 +350,11 @@ void Server::_handlePrivmsg(Client* client, const std::vector<std::string>& para
                 continue;
             }
             
-            std::string msg = ":" + client->getPrefix() + " PRIVMSG " + target + " :" + params[1];
-            _sendToChannel(channel, msg, client);
+            _sendFramedToChannel(channel, framed.data(), framed.length(), client);
+            channel->recordHistory(framed.data(), framed.length() - 2);
+            if (channel->isAudited())
+                _auditChannel(channel, std::string(framed.data(), framed.length() - 2));
+            delivered = true;
         } else {
             Client* targetClient = getClientByNick(target);
             if (!targetClient) {
@@ -310,18 +362,18 @@ void Server::_handlePrivmsg(Client* client, const std::vector<std::string>& para
                 continue;
             }
             
-            std::string msg = ":" + client->getPrefix() + " PRIVMSG " + target + " :" + params[1];
-            _sendToClient(targetClient->getFd(), msg);
+            _deliver(targetClient, framed.data(), framed.length());
+            delivered = true;
         }
     }
 }
 
-void Server::_handleQuit(Client* client, const std::vector<std::string>& params) {
+void Server::_handleQuit(Client* client, const Params& params) {
     std::string reason = params.empty() ? "Client Quit" : params[0];
     _disconnectClient(client->getFd(), reason);
 }
 
-void Server::_handlePing(Client* client, const std::vector<std::string>& params) {
+void Server::_handlePing(Client* client, const Params& params) {
     if (params.empty()) {
         _sendNumericReply(client, ERR_NOORIGIN, ":No origin specified");
         return;
@@ -330,7 +382,7 @@ void Server::_handlePing(Client* client, const std::vector<std::string>& params)
     _sendToClient(client->getFd(), ":" + _serverName + " PONG " + _serverName + " :" + params[0]);
 }
 
-void Server::_handleKick(Client* client, const std::vector<std::string>& params) {
+void Server::_handleKick(Client* client, const Params& params) {
     if (!client->isRegistered()) {
         _sendNumericReply(client, ERR_NOTREGISTERED, ":You have not registered");
         return;
@@ -371,12 +423,13 @@ void Server::_handleKick(Client* client, const std::vector<std::string>& params)
         
         std::string kickMsg = ":" + client->getPrefix() + " KICK " + params[0] + " " + targetNick + " :" + reason;
         _sendToChannel(channel, kickMsg);
+        _auditChannel(channel, kickMsg);
         
         target->leaveChannel(channel);
     }
 }
 
-void Server::_handleInvite(Client* client, const std::vector<std::string>& params) {
+void Server::_handleInvite(Client* client, const Params& params) {
     if (!client->isRegistered()) {
         _sendNumericReply(client, ERR_NOTREGISTERED, ":You have not registered");
         return;
@@ -419,7 +472,7 @@ void Server::_handleInvite(Client* client, const std::vector<std::string>& param
     _sendToClient(target->getFd(), ":" + client->getPrefix() + " INVITE " + params[0] + " :" + params[1]);
 }
 
-void Server::_handleTopic(Client* client, const std::vector<std::string>& params) {
+void Server::_handleTopic(Client* client, const Params& params) {
     if (!client->isRegistered()) {
         _sendNumericReply(client, ERR_NOTREGISTERED, ":You have not registered");
         return;
@@ -452,13 +505,17 @@ void Server::_handleTopic(Client* client, const std::vector<std::string>& params
             return;
         }
         
+        if (!_passesFilter(client, "TOPIC", params[0], params[1]))
+            return;
+        
         channel->setTopic(params[1], client);
         std::string topicMsg = ":" + client->getPrefix() + " TOPIC " + params[0] + " :" + params[1];
         _sendToChannel(channel, topicMsg);
+        _auditChannel(channel, topicMsg);
     }
 }
 
-void Server::_handleMode(Client* client, const std::vector<std::string>& params) {
+void Server::_handleMode(Client* client, const Params& params) {
     if (!client->isRegistered()) {
         _sendNumericReply(client, ERR_NOTREGISTERED, ":You have not registered");
         return;
@@ -486,6 +543,14 @@ void Server::_handleMode(Client* client, const std::vector<std::string>& params)
         return;
     }
     
+    std::string listQuery = params[1];
+    if (!listQuery.empty() && (listQuery[0] == '+' || listQuery[0] == '-'))
+        listQuery.erase(0, 1);
+    if (params.size() == 2 && (listQuery == "b" || listQuery == "e" || listQuery == "I")) {
+        _sendMaskList(client, channel, listQuery[0]);
+        return;
+    }
+    
     if (!channel->isOperator(client)) {
         _sendNumericReply(client, ERR_CHANOPRIVSNEEDED, params[0] + " :You're not channel operator");
         return;
@@ -512,6 +577,13 @@ void Server::_handleMode(Client* client, const std::vector<std::string>& params)
         } else if (mode == 't') {
             channel->setTopicRestricted(adding);
             appliedModes += "t";
+        } else if (mode == 'A') {
+            if (!client->isOperator()) {
+                _sendNumericReply(client, ERR_NOPRIVILEGES, ":Permission Denied- You're not an IRC operator");
+                continue;
+            }
+            channel->setAudited(adding);
+            appliedModes += "A";
         } else if (mode == 'k') {
             if (adding && paramIdx < params.size()) {
                 channel->setKey(params[paramIdx]);
@@ -533,6 +605,20 @@ void Server::_handleMode(Client* client, const std::vector<std::string>& params)
                 channel->removeUserLimit();
                 appliedModes += "l";
             }
+        } else if (mode == 'b' || mode == 'e' || mode == 'I') {
+            if (paramIdx >= params.size()) {
+                _sendMaskList(client, channel, mode);
+                continue;
+            }
+            
+            std::string mask = Channel::normalizeMask(params[paramIdx++]);
+            if (adding && channel->isMaskListFull(mode)) {
+                _sendNumericReply(client, ERR_BANLISTFULL, params[0] + " " + mask + " :Channel list is full");
+            } else if (adding ? channel->addMask(mode, mask, client->getPrefix())
+                              : channel->removeMask(mode, mask)) {
+                modeParams += " " + mask;
+                appliedModes += mode;
+            }
         } else if (mode == 'o') {
             if (paramIdx < params.size()) {
                 Client* target = getClientByNick(params[paramIdx]);
@@ -553,30 +639,123 @@ void Server::_handleMode(Client* client, const std::vector<std::string>& params)
     if (appliedModes.length() > 1) {
         std::string modeMsg = ":" + client->getPrefix() + " MODE " + params[0] + " " + appliedModes + modeParams;
         _sendToChannel(channel, modeMsg);
+        _auditChannel(channel, modeMsg);
     }
 }
 
-void Server::_handleWho(Client* client, const std::vector<std::string>& params) {
+void Server::_handleWho(Client* client, const Params& params) {
     if (!client->isRegistered()) {
         _sendNumericReply(client, ERR_NOTREGISTERED, ":You have not registered");
         return;
     }
     
     std::string mask = params.empty() ? "" : params[0];
+    std::string matchFields, fields, token;
+    bool operOnly = false;
     
-    if (!mask.empty() && (mask[0] == '#' || mask[0] == '&')) {
-        Channel* channel = getChannel(mask);
-        if (channel && channel->hasClient(client)) {
-            const std::set<Client*>& clients = channel->getClients();
-            for (std::set<Client*>::const_iterator it = clients.begin(); it != clients.end(); ++it)
-                _sendWhoReply(client, channel, *it);
+    if (params.size() > 1) {
+        std::string options = params[1];
+        size_t percent = options.find('%');
+        
+        for (size_t i = 0; i < options.length() && i < percent; i++) {
+            if (options[i] == 'o')
+                operOnly = true;
+            else if (std::string("nuhr").find(options[i]) != std::string::npos)
+                matchFields += options[i];
         }
+        
+        if (percent != std::string::npos) {
+            fields = options.substr(percent + 1);
+            size_t comma = fields.find(',');
+            if (comma != std::string::npos) {
+                token = fields.substr(comma + 1, 3);
+                fields.erase(comma);
+            }
+        }
+    }
+    
+    if (!mask.empty() && (mask[0] == '#' || mask[0] == '&')) {
+        _startStream(client, new WhoStream(mask, mask, fields, token));
+        return;
+    }
+    
+    if (!mask.empty()) {
+        std::vector<Client*> results;
+        _collectWhoMatches(mask == "0" ? "*" : mask, matchFields.empty() ? "nuhr" : matchFields, operOnly, results);
+        for (size_t i = 0; i < results.size(); i++)
+            _sendWhoReply(client, NULL, results[i], fields, token);
     }
     
     _sendNumericReply(client, RPL_ENDOFWHO, mask + " :End of /WHO list");
 }
 
-void Server::_handleWhois(Client* client, const std::vector<std::string>& params) {
+bool Server::_whoMatches(Client* target, const Mask& mask, const std::string& matchFields, bool operOnly) {
+    if (!target->isRegistered()) return false;
+    if (operOnly && !target->isOperator()) return false;
+    
+    for (size_t i = 0; i < matchFields.length(); i++) {
+        char field = matchFields[i];
+        if (field == 'n' && mask.matches(target->getNickname())) return true;
+        if (field == 'u' && mask.matches(target->getUsername())) return true;
+        if (field == 'h' && mask.matches(target->getHostname())) return true;
+        if (field == 'r' && mask.matches(target->getRealname())) return true;
+    }
+    return false;
+}
+
+void Server::_collectWhoMatches(const std::string& pattern, const std::string& matchFields, bool operOnly,
+                                std::vector<Client*>& results) {
+    static const size_t maxResults = 200;
+    Mask mask(pattern);
+    unsigned long epoch = ++_fanoutEpoch;
+    std::vector<Client*> candidates;
+    
+    if (matchFields == "h" && !mask.getSuffix().empty()) {
+        std::string key = mask.getSuffix();
+        std::reverse(key.begin(), key.end());
+        for (InternedIndex::iterator it = _clientsByHost.lower_bound(InternedString(key));
+             it != _clientsByHost.end() && it->first.str().compare(0, key.length(), key) == 0; ++it)
+            candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+    } else if (matchFields == "h" && mask.isLiteral()) {
+        std::string key = mask.getPattern();
+        std::reverse(key.begin(), key.end());
+        InternedIndex::iterator it = _clientsByHost.find(InternedString::find(key));
+        if (it != _clientsByHost.end())
+            candidates.assign(it->second.begin(), it->second.end());
+    } else if (matchFields == "u" && !mask.getPrefix().empty()) {
+        const std::string& key = mask.getPrefix();
+        for (InternedIndex::iterator it = _clientsByUser.lower_bound(InternedString(key));
+             it != _clientsByUser.end() && it->first.str().compare(0, key.length(), key) == 0; ++it)
+            candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+    } else if (mask.isLiteral() && matchFields.find('r') == std::string::npos) {
+        Client* byNick = matchFields.find('n') != std::string::npos ? getClientByNick(pattern) : NULL;
+        if (byNick)
+            candidates.push_back(byNick);
+        
+        std::string hostKey = mask.getPattern();
+        std::reverse(hostKey.begin(), hostKey.end());
+        InternedIndex::iterator it = _clientsByHost.find(InternedString::find(hostKey));
+        if (matchFields.find('h') != std::string::npos && it != _clientsByHost.end())
+            candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+        it = _clientsByUser.find(InternedString::find(mask.getPattern()));
+        if (matchFields.find('u') != std::string::npos && it != _clientsByUser.end())
+            candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+    } else {
+        for (std::map<int, Client*>::iterator it = _clients.begin(); it != _clients.end(); ++it)
+            candidates.push_back(it->second);
+    }
+    
+    for (size_t i = 0; i < candidates.size() && results.size() < maxResults; i++) {
+        Client* target = candidates[i];
+        if (target->getFanoutMark() == epoch) continue;
+        target->setFanoutMark(epoch);
+        
+        if (_whoMatches(target, mask, matchFields, operOnly))
+            results.push_back(target);
+    }
+}
+
+void Server::_handleWhois(Client* client, const Params& params) {
     if (!client->isRegistered()) {
         _sendNumericReply(client, ERR_NOTREGISTERED, ":You have not registered");
         return;
@@ -597,48 +776,258 @@ void Server::_handleWhois(Client* client, const std::vector<std::string>& params
     _sendNumericReply(client, RPL_ENDOFWHOIS, params[0] + " :End of /WHOIS list");
 }
 
-void Server::_handleList(Client* client, const std::vector<std::string>& params) {
+void Server::_handleWhowas(Client* client, const Params& params) {
+    if (!client->isRegistered()) {
+        _sendNumericReply(client, ERR_NOTREGISTERED, ":You have not registered");
+        return;
+    }
+    
+    if (params.empty() || params[0].empty()) {
+        _sendNumericReply(client, ERR_NONICKNAMEGIVEN, ":No nickname given");
+        return;
+    }
+    
+    size_t limit = _whowas.getCapacity();
+    if (params.size() > 1) {
+        int count = std::atoi(params[1].c_str());
+        if (count > 0 && static_cast<size_t>(count) < limit)
+            limit = count;
+    }
+    
+    std::istringstream nickStream(params[0]);
+    std::string nick;
+    while (std::getline(nickStream, nick, ',')) {
+        if (nick.empty()) continue;
+        
+        std::vector<const WhowasEntry*> entries;
+        _whowas.lookup(nick, limit, entries);
+        
+        if (entries.empty())
+            _sendNumericReply(client, ERR_WASNOSUCHNICK, nick + " :There was no such nickname");
+        
+        for (size_t i = 0; i < entries.size(); i++) {
+            const WhowasEntry* entry = entries[i];
+            char signoff[64];
+            strftime(signoff, sizeof(signoff), "%a %b %d %H:%M:%S %Y", localtime(&entry->signoff));
+            
+            _sendNumericReply(client, RPL_WHOWASUSER, entry->nickname.str() + " " + entry->username.str() + " " +
+                              entry->hostname.str() + " * :" + entry->realname.str());
+            _sendNumericReply(client, RPL_WHOISSERVER, entry->nickname.str() + " " + _serverName + " :" + signoff);
+        }
+        
+        _sendNumericReply(client, RPL_ENDOFWHOWAS, nick + " :End of WHOWAS");
+    }
+}
+
+void Server::_handleStats(Client* client, const Params& params) {
+    if (!client->isRegistered()) {
+        _sendNumericReply(client, ERR_NOTREGISTERED, ":You have not registered");
+        return;
+    }
+    
+    std::string query = params.empty() ? "" : params[0].substr(0, 1);
+    
+    if (!query.empty() && query != "u" && !client->isOperator())
+        _sendNumericReply(client, ERR_NOPRIVILEGES, ":Permission Denied- You're not an IRC operator");
+    else
+        _sendStatsReply(client, query);
+    
+    _sendNumericReply(client, RPL_ENDOFSTATS, (query.empty() ? "*" : query) + " :End of /STATS report");
+}
+
+void Server::_sendStatsReply(Client* client, const std::string& query) {
+    if (query == "z") {
+        const std::vector<SlabPool*>& pools = SlabPool::getPools();
+        for (size_t i = 0; i < pools.size(); i++) {
+            const SlabPool* pool = pools[i];
+            _sendNumericReply(client, RPL_STATSDEBUG, "z :" + std::string(pool->getName()) + " size=" + sizeToString(pool->getObjectSize())
+                              + " inuse=" + sizeToString(pool->getInUse()) + " capacity=" + sizeToString(pool->getCapacity())
+                              + " slabs=" + sizeToString(pool->getSlabCount()) + "x" + sizeToString(pool->getSlabBytes())
+                              + " allocations=" + sizeToString(pool->getAllocations()));
+        }
+        _sendNumericReply(client, RPL_STATSDEBUG, std::string("z :hugepages=") + (SlabPool::isUsingHugePages() ? "on" : "off"));
+        
+        const BufferPool& buffers = BufferPool::instance();
+        for (size_t i = 0; i < BufferPool::CLASS_COUNT; i++) {
+            const BufferPool::SizeClass& sizeClass = buffers.getClass(i);
+            _sendNumericReply(client, RPL_STATSDEBUG, "z :buffer size=" + sizeToString(sizeClass.size)
+                              + " inuse=" + sizeToString(sizeClass.inUse) + " free=" + sizeToString(sizeClass.free.size()));
+        }
+        
+        size_t bufferBytes = 0;
+        size_t largest = 0;
+        for (std::map<int, Client*>::const_iterator it = _clients.begin(); it != _clients.end(); ++it) {
+            size_t bytes = it->second->getBufferCapacity();
+            bufferBytes += bytes;
+            if (bytes > largest)
+                largest = bytes;
+        }
+        _sendNumericReply(client, RPL_STATSDEBUG, "z :connections=" + sizeToString(_clients.size())
+                          + " bufferbytes=" + sizeToString(bufferBytes)
+                          + " perconnection=" + sizeToString(_clients.empty() ? 0 : bufferBytes / _clients.size())
+                          + " largest=" + sizeToString(largest) + " trimmed=" + sizeToString(buffers.getTrimmed()));
+        _sendNumericReply(client, RPL_STATSDEBUG, "z :interned=" + sizeToString(InternedString::poolSize()));
+    } else if (query == "m") {
+        for (size_t i = 0; i < Metrics::COMMAND_COUNT; i++) {
+            const CommandMetrics& command = _metrics.getCommand(i);
+            if (command.calls == 0) continue;
+            
+            std::ostringstream oss;
+            oss << Metrics::commandName(i) << " " << command.calls << " " << command.bytes << " 0";
+            _sendNumericReply(client, RPL_STATSCOMMANDS, oss.str());
+        }
+    } else if (query == "l") {
+        for (size_t i = 0; i < Metrics::COMMAND_COUNT; i++) {
+            const CommandMetrics& command = _metrics.getCommand(i);
+            if (command.calls == 0) continue;
+            
+            _sendNumericReply(client, RPL_STATSDEBUG, "l :" + std::string(Metrics::commandName(i)) + " "
+                              + command.latency.summarize("ns", 1));
+        }
+    } else if (query == "e") {
+        std::ostringstream oss;
+        oss << "e :iterations=" << _metrics.getIterations() << " bytesin=" << _metrics.getBytesIn()
+            << " bytesout=" << _metrics.getBytesOut();
+        _sendNumericReply(client, RPL_STATSDEBUG, oss.str());
+        _sendNumericReply(client, RPL_STATSDEBUG, "e :iteration " + _metrics.getIterationTime().summarize("ns", 1));
+        _sendNumericReply(client, RPL_STATSDEBUG, "e :ready " + _metrics.getReadyFds().summarize("", 1));
+    } else if (query == "q") {
+        Histogram sendQueues;
+        Histogram recvQueues;
+        for (std::map<int, Client*>::const_iterator it = _clients.begin(); it != _clients.end(); ++it) {
+            sendQueues.record(it->second->getSendQueueSize());
+            recvQueues.record(it->second->getBufferSize());
+        }
+        _sendNumericReply(client, RPL_STATSDEBUG, "q :sendq " + sendQueues.summarize("B", 1));
+        _sendNumericReply(client, RPL_STATSDEBUG, "q :recvq " + recvQueues.summarize("B", 1));
+    } else if (query == "t") {
+        std::vector<HeavyHitter> top;
+        for (size_t i = 0; i < HITTER_DIMENSIONS; i++) {
+            _hitters[i].snapshot(top, time(NULL));
+            for (size_t rank = 0; rank < top.size(); rank++)
+                if (top[rank].estimate)
+                    _sendNumericReply(client, RPL_STATSDEBUG, "t :" + std::string(hitterDimensionName(i)) + " "
+                                      + sizeToString(rank + 1) + " " + top[rank].key + " " + sizeToString(top[rank].estimate));
+        }
+        _sendNumericReply(client, RPL_STATSDEBUG, "t :window halflife=" + sizeToString(_hitters[0].getHalfLife())
+                          + "s memory=" + sizeToString(_hitters.size() * _hitters[0].getMemoryUsage()));
+    } else if (query == "u") {
+        time_t uptime = time(NULL) - _startTime;
+        std::ostringstream oss;
+        oss << ":Server Up " << uptime / 86400 << " days " << std::setfill('0') << std::setw(2) << (uptime / 3600) % 24
+            << ":" << std::setw(2) << (uptime / 60) % 60 << ":" << std::setw(2) << uptime % 60;
+        _sendNumericReply(client, RPL_STATSUPTIME, oss.str());
+    }
+}
+
+void Server::_handleOper(Client* client, const Params& params) {
     if (!client->isRegistered()) {
         _sendNumericReply(client, ERR_NOTREGISTERED, ":You have not registered");
         return;
     }
     
+    if (params.size() < 2) {
+        _sendNumericReply(client, ERR_NEEDMOREPARAMS, "OPER :Not enough parameters");
+        return;
+    }
+    
+    if (_operPassword.empty()) {
+        _sendNumericReply(client, ERR_NOOPERHOST, ":No O-lines for your host");
+        return;
+    }
+    
+    if (params[1] != _operPassword) {
+        _sendNumericReply(client, ERR_PASSWDMISMATCH, ":Password incorrect");
+        _logMessage("WARNING", "Failed OPER attempt by " + client->getFullIdentifier());
+        return;
+    }
+    
+    client->setOperator(true);
+    _operators.insert(client);
+    _sendNumericReply(client, RPL_YOUREOPER, ":You are now an IRC operator");
+    _sendToClient(client->getFd(), ":" + client->getPrefix() + " MODE " + client->getNickname() + " :+o");
+    _logMessage("INFO", client->getFullIdentifier() + " is now an IRC operator");
+}
+
+void Server::_handleRehash(Client* client, const Params& params) {
     (void)params;
     
-    for (std::map<std::string, Channel*>::iterator it = _channels.begin(); it != _channels.end(); ++it) {
-        if (!it->second->isSecret() || it->second->hasClient(client))
-            _sendListReply(client, it->second);
+    if (!client->isRegistered()) {
+        _sendNumericReply(client, ERR_NOTREGISTERED, ":You have not registered");
+        return;
+    }
+    
+    if (!client->isOperator()) {
+        _sendNumericReply(client, ERR_NOPRIVILEGES, ":Permission Denied- You're not an IRC operator");
+        return;
     }
     
-    _sendNumericReply(client, RPL_LISTEND, ":End of /LIST");
+    _sendNumericReply(client, RPL_REHASHING, _motdPath + " :Rehashing");
+    rehash();
 }
 
-void Server::_handleNames(Client* client, const std::vector<std::string>& params) {
+void Server::_handleList(Client* client, const Params& params) {
     if (!client->isRegistered()) {
         _sendNumericReply(client, ERR_NOTREGISTERED, ":You have not registered");
         return;
     }
     
-    if (params.empty()) {
-        for (std::map<std::string, Channel*>::iterator it = _channels.begin(); it != _channels.end(); ++it) {
-            if (!it->second->isSecret() || it->second->hasClient(client))
-                _sendNumericReply(client, RPL_NAMREPLY, "= " + it->first + " :" + it->second->getNamesReply());
+    std::vector<std::string> items;
+    bool filtered = false;
+    
+    if (!params.empty()) {
+        std::istringstream itemStream(params[0]);
+        std::string item;
+        while (std::getline(itemStream, item, ',')) {
+            if (item.empty()) continue;
+            items.push_back(item);
+            if (!_isValidChannelName(item) || Mask::hasWildcards(item))
+                filtered = true;
         }
+    }
+    
+    if (!items.empty() && !filtered) {
+        for (size_t i = 0; i < items.size(); i++) {
+            Channel* channel = getChannel(items[i]);
+            if (channel && (!channel->isSecret() || channel->hasClient(client)))
+                _sendListReply(client, channel);
+        }
+        _sendNumericReply(client, RPL_LISTEND, ":End of /LIST");
+        return;
+    }
+    
+    ListFilter filter;
+    time_t now = time(NULL);
+    for (size_t i = 0; i < items.size(); i++)
+        filter.parse(items[i], now);
+    
+    _startStream(client, new ListStream(filter));
+}
+
+void Server::_handleNames(Client* client, const Params& params) {
+    if (!client->isRegistered()) {
+        _sendNumericReply(client, ERR_NOTREGISTERED, ":You have not registered");
+        return;
+    }
+    
+    std::vector<std::string> channelNames;
+    
+    if (params.empty()) {
+        for (ChannelIndex::iterator it = _channels.begin(); it != _channels.end(); ++it)
+            channelNames.push_back(it->first.str());
     } else {
         std::istringstream channelStream(params[0]);
         std::string channelName;
         
-        while (std::getline(channelStream, channelName, ',')) {
-            Channel* channel = getChannel(channelName);
-            if (channel && (!channel->isSecret() || channel->hasClient(client)))
-                _sendNumericReply(client, RPL_NAMREPLY, "= " + channelName + " :" + channel->getNamesReply());
-        }
+        while (std::getline(channelStream, channelName, ','))
+            if (!channelName.empty())
+                channelNames.push_back(channelName);
     }
     
-    _sendNumericReply(client, RPL_ENDOFNAMES, "* :End of /NAMES list");
+    _startStream(client, new NamesStream(channelNames, "*"));
 }
 
-void Server::_handleMotd(Client* client, const std::vector<std::string>& params) {
+void Server::_handleMotd(Client* client, const Params& params) {
     (void)params;
     
     if (!client->isRegistered()) {
@@ -649,17 +1038,190 @@ void Server::_handleMotd(Client* client, const std::vector<std::string>& params)
     _sendMotd(client);
 }
 
-void Server::_sendWhoReply(Client* client, Channel* channel, Client* target) {
+void Server::_handleMonitor(Client* client, const Params& params) {
+    if (!client->isRegistered()) {
+        _sendNumericReply(client, ERR_NOTREGISTERED, ":You have not registered");
+        return;
+    }
+    
+    if (params.empty() || params[0].length() != 1) {
+        _sendNumericReply(client, ERR_NEEDMOREPARAMS, "MONITOR :Not enough parameters");
+        return;
+    }
+    
+    char action = params[0][0];
+    std::vector<std::string> nicks;
+    if (params.size() > 1) {
+        std::istringstream nickStream(params[1]);
+        std::string nick;
+        while (std::getline(nickStream, nick, ','))
+            if (!nick.empty())
+                nicks.push_back(nick);
+    }
+    
+    if (action == '+') {
+        std::vector<std::string> added;
+        for (size_t i = 0; i < nicks.size(); i++) {
+            std::string folded = ircCasefold(nicks[i]);
+            if (client->getMonitoring().count(folded)) continue;
+            
+            if (client->getMonitoring().size() >= _monitorLimit) {
+                std::string rest;
+                for (size_t j = i; j < nicks.size(); j++)
+                    rest += (rest.empty() ? "" : ",") + nicks[j];
+                _sendNumericReply(client, ERR_MONLISTFULL, sizeToString(_monitorLimit) + " " + rest + " :Monitor list is full");
+                break;
+            }
+            
+            client->addMonitor(folded);
+            _monitors[folded].insert(client);
+            added.push_back(nicks[i]);
+        }
+        _sendMonitorStatus(client, added);
+    } else if (action == '-') {
+        for (size_t i = 0; i < nicks.size(); i++) {
+            std::string folded = ircCasefold(nicks[i]);
+            if (!client->removeMonitor(folded)) continue;
+            
+            ClientIndex::iterator it = _monitors.find(folded);
+            if (it != _monitors.end()) {
+                it->second.erase(client);
+                if (it->second.empty())
+                    _monitors.erase(it);
+            }
+        }
+    } else if (action == 'C' || action == 'c') {
+        _clearMonitors(client);
+    } else if (action == 'L' || action == 'l') {
+        const std::set<std::string>& watching = client->getMonitoring();
+        std::string line;
+        for (std::set<std::string>::const_iterator it = watching.begin(); it != watching.end(); ++it) {
+            if (!line.empty() && line.length() + it->length() > 400) {
+                _sendNumericReply(client, RPL_MONLIST, ":" + line);
+                line.clear();
+            }
+            line += (line.empty() ? "" : ",") + *it;
+        }
+        if (!line.empty())
+            _sendNumericReply(client, RPL_MONLIST, ":" + line);
+        _sendNumericReply(client, RPL_ENDOFMONLIST, ":End of MONITOR list");
+    } else if (action == 'S' || action == 's') {
+        const std::set<std::string>& watching = client->getMonitoring();
+        _sendMonitorStatus(client, std::vector<std::string>(watching.begin(), watching.end()));
+    }
+}
+
+void Server::_sendMonitorStatus(Client* client, const std::vector<std::string>& nicks) {
+    std::string online, offline;
+    
+    for (size_t i = 0; i < nicks.size(); i++) {
+        Client* target = getClientByNick(nicks[i]);
+        if (target && target->isRegistered()) {
+            if (!online.empty() && online.length() > 400) {
+                _sendNumericReply(client, RPL_MONONLINE, ":" + online);
+                online.clear();
+            }
+            online += (online.empty() ? "" : ",") + target->getPrefix();
+        } else {
+            if (!offline.empty() && offline.length() > 400) {
+                _sendNumericReply(client, RPL_MONOFFLINE, ":" + offline);
+                offline.clear();
+            }
+            offline += (offline.empty() ? "" : ",") + nicks[i];
+        }
+    }
+    
+    if (!online.empty())
+        _sendNumericReply(client, RPL_MONONLINE, ":" + online);
+    if (!offline.empty())
+        _sendNumericReply(client, RPL_MONOFFLINE, ":" + offline);
+}
+
+void Server::_notifyMonitors(Client* target, const std::string& nickname, bool online) {
+    ClientIndex::iterator it = _monitors.find(ircCasefold(nickname));
+    if (it == _monitors.end()) return;
+    
+    int code = online ? RPL_MONONLINE : RPL_MONOFFLINE;
+    std::string payload = ":" + (online ? target->getPrefix() : nickname);
+    
+    for (ClientSet::iterator wIt = it->second.begin(); wIt != it->second.end(); ++wIt)
+        _sendNumericReply(*wIt, code, payload);
+}
+
+void Server::_clearMonitors(Client* client) {
+    const std::set<std::string>& watching = client->getMonitoring();
+    for (std::set<std::string>::const_iterator it = watching.begin(); it != watching.end(); ++it) {
+        ClientIndex::iterator mIt = _monitors.find(*it);
+        if (mIt == _monitors.end()) continue;
+        
+        mIt->second.erase(client);
+        if (mIt->second.empty())
+            _monitors.erase(mIt);
+    }
+    client->clearMonitors();
+}
+
+void Server::_sendMaskList(Client* client, Channel* channel, char type) {
+    if (!channel->hasClient(client)) {
+        _sendNumericReply(client, ERR_NOTONCHANNEL, channel->getName() + " :You're not on that channel");
+        return;
+    }
+    
+    int entryCode = type == 'b' ? RPL_BANLIST : (type == 'e' ? RPL_EXCEPTLIST : RPL_INVITELIST);
+    int endCode = type == 'b' ? RPL_ENDOFBANLIST : (type == 'e' ? RPL_ENDOFEXCEPTLIST : RPL_ENDOFINVITELIST);
+    const char* endText = type == 'b' ? " :End of channel ban list"
+                        : (type == 'e' ? " :End of channel exception list" : " :End of channel invite list");
+    
+    const std::vector<ChannelListEntry>& list = channel->getMaskList(type);
+    for (size_t i = 0; i < list.size(); i++)
+        _sendNumericReply(client, entryCode, channel->getName() + " " + list[i].text + " "
+                          + list[i].setter + " " + intToString(static_cast<int>(list[i].setTime)));
+    
+    _sendNumericReply(client, endCode, channel->getName() + endText);
+}
+
+void Server::_sendWhoReply(Client* client, Channel* channel, Client* target,
+                           const std::string& fields, const std::string& token) {
     std::string flags = "H";
+    if (target->isOperator())
+        flags += "*";
     if (channel && channel->isOperator(target))
         flags += "@";
     
     std::ostringstream oss;
-    oss << (channel ? channel->getName() : "*") << " " << target->getUsername() << " "
-        << target->getHostname() << " " << _serverName << " "
-        << target->getNickname() << " " << flags << " :0 " << target->getRealname();
     
-    _sendNumericReply(client, RPL_WHOREPLY, oss.str());
+    if (fields.empty()) {
+        oss << (channel ? channel->getName() : "*") << " " << target->getUsername() << " "
+            << target->getHostname() << " " << _serverName << " "
+            << target->getNickname() << " " << flags << " :0 " << target->getRealname();
+        
+        _sendNumericReply(client, RPL_WHOREPLY, oss.str());
+        return;
+    }
+    
+    static const char order[] = "tcuihsnfdlaor";
+    for (const char* field = order; *field; field++) {
+        if (fields.find(*field) == std::string::npos) continue;
+        if (oss.tellp() > 0) oss << " ";
+        
+        switch (*field) {
+            case 't': oss << (token.empty() ? "0" : token); break;
+            case 'c': oss << (channel ? channel->getName() : "*"); break;
+            case 'u': oss << target->getUsername(); break;
+            case 'i': oss << target->getHostname(); break;
+            case 'h': oss << target->getHostname(); break;
+            case 's': oss << _serverName; break;
+            case 'n': oss << target->getNickname(); break;
+            case 'f': oss << flags; break;
+            case 'd': oss << "0"; break;
+            case 'l': oss << target->getIdleTime(); break;
+            case 'a': oss << "0"; break;
+            case 'o': oss << "n/a"; break;
+            case 'r': oss << ":" << target->getRealname(); break;
+        }
+    }
+    
+    _sendNumericReply(client, RPL_WHOSPCRPL, oss.str());
 }
 
 void Server::_sendWhoisReply(Client* client, Client* target) {
@@ -670,8 +1232,8 @@ void Server::_sendWhoisReply(Client* client, Client* target) {
                      _serverName + " :" + _serverName);
     
     std::string channels;
-    const std::set<Channel*>& targetChannels = target->getChannels();
-    for (std::set<Channel*>::const_iterator it = targetChannels.begin(); it != targetChannels.end(); ++it) {
+    const ChannelSet& targetChannels = target->getChannels();
+    for (ChannelSet::const_iterator it = targetChannels.begin(); it != targetChannels.end(); ++it) {
         if (!(*it)->isSecret() || (*it)->hasClient(client)) {
             if (!channels.empty()) channels += " ";
             if ((*it)->isOperator(target)) channels += "@";
@@ -693,4 +1255,126 @@ void Server::_sendListReply(Client* client, Channel* channel) {
         << (channel->getTopic().empty() ? "" : channel->getTopic());
     
     _sendNumericReply(client, RPL_LIST, oss.str());
+}
+
+static bool resolveHistoryRef(const ChannelHistory* history, const std::string& ref,
+                              unsigned long& before, unsigned long& after) {
+    if (ref.compare(0, 6, "msgid=") == 0) {
+        unsigned long seq;
+        if (!history->parseMsgid(ref.substr(6), seq))
+            return false;
+        before = seq;
+        after = seq + 1;
+        return true;
+    }
+    
+    long long timeMs;
+    if (ref.compare(0, 10, "timestamp=") != 0 || !ChannelHistory::parseTime(ref.substr(10), timeMs))
+        return false;
+    before = history->findTime(timeMs);
+    after = history->findTime(timeMs + 1);
+    return true;
+}
+
+static bool isHistoryRef(const std::string& ref) {
+    return ref.compare(0, 6, "msgid=") == 0 || ref.compare(0, 10, "timestamp=") == 0;
+}
+
+void Server::_handleChathistory(Client* client, const Params& params) {
+    if (!client->isRegistered()) {
+        _sendNumericReply(client, ERR_NOTREGISTERED, ":You have not registered");
+        return;
+    }
+    
+    std::string subcommand = params.empty() ? "" : params[0];
+    std::transform(subcommand.begin(), subcommand.end(), subcommand.begin(), ::toupper);
+    std::string fail = ":" + _serverName + " FAIL CHATHISTORY ";
+    
+    bool between = subcommand == "BETWEEN";
+    if (subcommand != "LATEST" && subcommand != "BEFORE" && subcommand != "AFTER"
+        && subcommand != "AROUND" && !between) {
+        _sendToClient(client->getFd(), fail + "UNKNOWN_COMMAND " + (subcommand.empty() ? "*" : subcommand) + " :Unknown subcommand");
+        return;
+    }
+    
+    if (params.size() < (between ? 5u : 4u)) {
+        _sendToClient(client->getFd(), fail + "NEED_MORE_PARAMS " + subcommand + " :Insufficient parameters");
+        return;
+    }
+    
+    const std::string& target = params[1];
+    const std::string& ref = params[2];
+    std::string otherRef = between ? params[3] : "";
+    long limit = std::atol(params[between ? 4 : 3].c_str());
+    
+    if (limit <= 0 || (!isHistoryRef(ref) && !(subcommand == "LATEST" && ref == "*"))
+        || (between && !isHistoryRef(otherRef))) {
+        _sendToClient(client->getFd(), fail + "INVALID_PARAMS " + subcommand + " :Invalid parameters");
+        return;
+    }
+    if (static_cast<size_t>(limit) > _historyQueryLimit)
+        limit = _historyQueryLimit;
+    
+    Channel* channel = getChannel(target);
+    if (!channel || !channel->hasClient(client)) {
+        _sendToClient(client->getFd(), fail + "INVALID_TARGET " + subcommand + " " + target + " :Messages could not be retrieved");
+        return;
+    }
+    
+    static unsigned long batchCounter = 0;
+    std::string batch = "h" + sizeToString(++batchCounter);
+    
+    const ChannelHistory* history = channel->getHistory();
+    if (!history) {
+        _startStream(client, new HistoryStream(channel->getName(), "", batch, 0, 0));
+        return;
+    }
+    
+    unsigned long first = history->getFirstSeq();
+    unsigned long next = history->getNextSeq();
+    unsigned long count = static_cast<unsigned long>(limit);
+    unsigned long start = 0;
+    unsigned long end = 0;
+    unsigned long before;
+    unsigned long after;
+    
+    if (subcommand == "LATEST") {
+        start = first;
+        end = next;
+        if (ref != "*" && resolveHistoryRef(history, ref, before, after))
+            start = after;
+        else if (ref != "*")
+            end = start;
+        if (end > start + count)
+            start = end - count;
+    } else if (resolveHistoryRef(history, ref, before, after)) {
+        if (subcommand == "BEFORE") {
+            end = before;
+            start = end > first + count ? end - count : first;
+        } else if (subcommand == "AFTER") {
+            start = after;
+            end = std::min(next, start + count);
+        } else if (subcommand == "AROUND") {
+            start = before > first + count / 2 ? before - count / 2 : first;
+            end = std::min(next, start + count);
+        } else {
+            unsigned long otherBefore;
+            unsigned long otherAfter;
+            if (resolveHistoryRef(history, otherRef, otherBefore, otherAfter)) {
+                if (before <= otherBefore) {
+                    start = after;
+                    end = std::min(otherBefore, start + count);
+                } else {
+                    start = otherAfter;
+                    end = before;
+                    if (end > start + count)
+                        start = end - count;
+                }
+            }
+        }
+    }
+    
+    if (start > end)
+        start = end;
+    _startStream(client, new HistoryStream(channel->getName(), history->getId(), batch, start, end));
 }
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "SpamDetector.hpp"
+
+#include <cctype>
+
+CountMinSketch::CountMinSketch(size_t width, size_t depth, time_t halfLife)
+    : _cells(width * depth, 0), _width(width), _depth(depth), _halfLife(halfLife > 0 ? halfLife : 1), _lastDecay(0) {}
+
+void CountMinSketch::_decay(time_t now) {
+    if (_lastDecay == 0) {
+        _lastDecay = now;
+        return;
+    }
+    
+    time_t periods = (now - _lastDecay) / _halfLife;
+    if (periods <= 0) return;
+    
+    _lastDecay += periods * _halfLife;
+    if (periods >= 16) {
+        _cells.assign(_cells.size(), 0);
+        return;
+    }
+    for (size_t i = 0; i < _cells.size(); i++)
+        _cells[i] >>= periods;
+}
+
+unsigned int CountMinSketch::add(unsigned long long hash, unsigned int weight, time_t now) {
+    _decay(now);
+    
+    unsigned int first = static_cast<unsigned int>(hash);
+    unsigned int step = static_cast<unsigned int>(hash >> 32) | 1;
+    unsigned int estimate = 0xffff;
+    
+    for (size_t row = 0; row < _depth; row++) {
+        unsigned short& cell = _cells[row * _width + (first + row * step) % _width];
+        unsigned int value = cell + weight;
+        cell = static_cast<unsigned short>(value > 0xffff ? 0xffff : value);
+        if (cell < estimate)
+            estimate = cell;
+    }
+    return estimate;
+}
+
+SpamDetector::SpamDetector()
+    : _global(4096, 4, 30), _minLength(12), _sourceThrottle(4), _sourceDrop(8),
+      _globalThrottle(20), _globalDrop(0), _throttled(0), _dropped(0) {}
+
+bool SpamDetector::normalizedHash(const std::string& text, size_t minLength, unsigned long long& hash) {
+    hash = 14695981039346656037ULL;
+    size_t length = 0;
+    
+    for (size_t i = 0; i < text.length(); i++) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (!isalnum(c)) continue;
+        
+        hash ^= static_cast<unsigned char>(tolower(c));
+        hash *= 1099511628211ULL;
+        length++;
+    }
+    return length >= minLength;
+}
+
+SpamVerdict SpamDetector::check(CountMinSketch& source, const std::string& text, size_t targets, time_t now) {
+    unsigned long long hash;
+    if (!normalizedHash(text, _minLength, hash))
+        return SPAM_NONE;
+    
+    unsigned int weight = static_cast<unsigned int>(targets ? targets : 1);
+    unsigned int fromSource = source.add(hash, weight, now);
+    unsigned int overall = _global.add(hash, weight, now);
+    
+    if (_exceeds(fromSource, _sourceDrop) || _exceeds(overall, _globalDrop)) {
+        _dropped++;
+        return SPAM_DROP;
+    }
+    if (_exceeds(fromSource, _sourceThrottle) || _exceeds(overall, _globalThrottle)) {
+        _throttled++;
+        return SPAM_THROTTLE;
+    }
+    return SPAM_NONE;
+}
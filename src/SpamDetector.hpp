@@ -0,0 +1,60 @@
+#ifndef SPAMDETECTOR_HPP
+#define SPAMDETECTOR_HPP
+
+#include <string>
+#include <vector>
+#include <ctime>
+
+class CountMinSketch {
+private:
+    std::vector<unsigned short> _cells;
+    size_t _width;
+    size_t _depth;
+    time_t _halfLife;
+    time_t _lastDecay;
+    
+    void _decay(time_t now);
+    
+public:
+    CountMinSketch(size_t width, size_t depth, time_t halfLife);
+    
+    unsigned int add(unsigned long long hash, unsigned int weight, time_t now);
+    void setHalfLife(time_t seconds) { _halfLife = seconds > 0 ? seconds : 1; }
+    size_t getMemoryUsage() const { return _cells.size() * sizeof(unsigned short); }
+};
+
+enum SpamVerdict {
+    SPAM_NONE = 0,
+    SPAM_THROTTLE,
+    SPAM_DROP
+};
+
+class SpamDetector {
+private:
+    CountMinSketch _global;
+    size_t _minLength;
+    unsigned int _sourceThrottle;
+    unsigned int _sourceDrop;
+    unsigned int _globalThrottle;
+    unsigned int _globalDrop;
+    size_t _throttled;
+    size_t _dropped;
+    
+    static bool _exceeds(unsigned int count, unsigned int threshold) { return threshold && count > threshold; }
+    
+public:
+    SpamDetector();
+    
+    static bool normalizedHash(const std::string& text, size_t minLength, unsigned long long& hash);
+    
+    SpamVerdict check(CountMinSketch& source, const std::string& text, size_t targets, time_t now);
+    
+    void setSourceThresholds(unsigned int throttle, unsigned int drop) { _sourceThrottle = throttle; _sourceDrop = drop; }
+    void setGlobalThresholds(unsigned int throttle, unsigned int drop) { _globalThrottle = throttle; _globalDrop = drop; }
+    void setMinLength(size_t length) { _minLength = length; }
+    
+    size_t getThrottled() const { return _throttled; }
+    size_t getDropped() const { return _dropped; }
+};
+
+#endif
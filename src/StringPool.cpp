@@ -0,0 +1,73 @@
+#include "StringPool.hpp"
+
+InternedString::Pool& InternedString::_pool() {
+    static Pool pool;
+    return pool;
+}
+
+InternedString::InternedString() : _valid(false) {}
+
+InternedString::InternedString(const std::string& value) : _valid(!value.empty()) {
+    if (!_valid) return;
+    
+    _entry = _pool().find(value);
+    if (_entry == _pool().end())
+        _entry = _pool().insert(std::make_pair(value, static_cast<size_t>(0))).first;
+    _entry->second++;
+}
+
+InternedString::InternedString(const InternedString& other) : _entry(other._entry), _valid(other._valid) {
+    if (_valid)
+        _entry->second++;
+}
+
+InternedString& InternedString::operator=(const InternedString& other) {
+    if (this == &other) return *this;
+    
+    if (other._valid)
+        other._entry->second++;
+    _release();
+    _entry = other._entry;
+    _valid = other._valid;
+    return *this;
+}
+
+InternedString::~InternedString() {
+    _release();
+}
+
+void InternedString::_release() {
+    if (!_valid) return;
+    
+    if (--_entry->second == 0)
+        _pool().erase(_entry);
+    _valid = false;
+}
+
+const std::string& InternedString::str() const {
+    static const std::string empty;
+    return _valid ? _entry->first : empty;
+}
+
+bool InternedString::operator==(const InternedString& other) const {
+    if (!_valid || !other._valid)
+        return _valid == other._valid;
+    return _entry == other._entry;
+}
+
+bool InternedString::operator<(const InternedString& other) const {
+    if (_valid && other._valid && _entry == other._entry)
+        return false;
+    return str() < other.str();
+}
+
+InternedString InternedString::find(const std::string& value) {
+    InternedString handle;
+    Pool::iterator it = _pool().find(value);
+    if (it != _pool().end()) {
+        handle._entry = it;
+        handle._valid = true;
+        it->second++;
+    }
+    return handle;
+}
@@ -0,0 +1,34 @@
+#ifndef STRINGPOOL_HPP
+#define STRINGPOOL_HPP
+
+#include <string>
+#include <map>
+
+class InternedString {
+private:
+    typedef std::map<std::string, size_t> Pool;
+    
+    Pool::iterator _entry;
+    bool _valid;
+    
+    static Pool& _pool();
+    void _release();
+    
+public:
+    InternedString();
+    explicit InternedString(const std::string& value);
+    InternedString(const InternedString& other);
+    InternedString& operator=(const InternedString& other);
+    ~InternedString();
+    
+    const std::string& str() const;
+    bool empty() const { return !_valid; }
+    bool operator==(const InternedString& other) const;
+    bool operator!=(const InternedString& other) const { return !(*this == other); }
+    bool operator<(const InternedString& other) const;
+    
+    static InternedString find(const std::string& value);
+    static size_t poolSize() { return _pool().size(); }
+};
+
+#endif
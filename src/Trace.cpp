@@ -0,0 +1,167 @@
+#include "Trace.hpp"
+
+#include <cstdio>
+#include <csignal>
+#include <fstream>
+#include <algorithm>
+#include <dirent.h>
+#include <unistd.h>
+
+TraceRing::TraceRing(size_t capacity) : _head(0) {
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+    _events.resize(size);
+    _mask = size - 1;
+}
+
+void TraceRing::snapshot(std::vector<TraceEvent>& out, unsigned long long windowNs) const {
+    size_t count = _head < _events.size() ? _head : _events.size();
+    unsigned long long now = Metrics::nowNs();
+    unsigned long long since = now > windowNs ? now - windowNs : 0;
+    
+    out.clear();
+    for (size_t i = _head - count; i < _head; i++) {
+        const TraceEvent& event = _events[i & _mask];
+        if (event.start + event.duration >= since)
+            out.push_back(event);
+    }
+}
+
+void TraceRing::render(std::string& out, unsigned long long windowNs) const {
+    std::vector<TraceEvent> events;
+    snapshot(events, windowNs);
+    renderEvents(events, out);
+}
+
+void TraceRing::renderEvents(const std::vector<TraceEvent>& events, std::string& out) {
+    char entry[192];
+    
+    out.clear();
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (size_t i = 0; i < events.size(); i++) {
+        const TraceEvent& event = events[i];
+        int length = snprintf(entry, sizeof(entry),
+                              "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%llu.%03llu,\"dur\":%llu.%03llu}",
+                              i ? "," : "", event.name,
+                              event.start / 1000, event.start % 1000, event.duration / 1000, event.duration % 1000);
+        out.append(entry, length);
+    }
+    out += "\n]}\n";
+}
+
+TraceWriter::TraceWriter() : _started(false), _stopping(false), _scanned(false), _directory("."), _maxFiles(10) {
+    pthread_mutex_init(&_mutex, NULL);
+    pthread_cond_init(&_cond, NULL);
+}
+
+TraceWriter::~TraceWriter() {
+    if (_started) {
+        pthread_mutex_lock(&_mutex);
+        _stopping = true;
+        pthread_cond_signal(&_cond);
+        pthread_mutex_unlock(&_mutex);
+        pthread_join(_thread, NULL);
+    }
+    pthread_cond_destroy(&_cond);
+    pthread_mutex_destroy(&_mutex);
+}
+
+bool TraceWriter::submit(const std::string& name, const TraceRing& ring, unsigned long long windowNs) {
+    pthread_mutex_lock(&_mutex);
+    if (!_started) {
+        sigset_t all, previous;
+        sigfillset(&all);
+        pthread_sigmask(SIG_SETMASK, &all, &previous);
+        _started = pthread_create(&_thread, NULL, _run, this) == 0;
+        pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    }
+    bool queued = _started && _jobs.empty();
+    if (queued) {
+        _jobs.push_back(Job());
+        _jobs.back().name = name;
+        ring.snapshot(_jobs.back().events, windowNs);
+        pthread_cond_signal(&_cond);
+    }
+    pthread_mutex_unlock(&_mutex);
+    return queued;
+}
+
+bool TraceWriter::takeResult(std::string& path, bool& written) {
+    pthread_mutex_lock(&_mutex);
+    bool found = !_results.empty();
+    if (found) {
+        path = _results.front().path;
+        written = _results.front().written;
+        _results.pop_front();
+    }
+    pthread_mutex_unlock(&_mutex);
+    return found;
+}
+
+void* TraceWriter::_run(void* self) {
+    static_cast<TraceWriter*>(self)->_workerLoop();
+    return NULL;
+}
+
+void TraceWriter::_workerLoop() {
+    pthread_mutex_lock(&_mutex);
+    for (;;) {
+        while (_jobs.empty() && !_stopping)
+            pthread_cond_wait(&_cond, &_mutex);
+        if (_jobs.empty())
+            break;
+        
+        Job job;
+        job.name.swap(_jobs.front().name);
+        job.events.swap(_jobs.front().events);
+        pthread_mutex_unlock(&_mutex);
+        
+        if (!_scanned)
+            _scan();
+        Result result;
+        result.path = _directory + "/" + job.name;
+        result.written = _write(result.path, job.events);
+        if (result.written && std::find(_kept.begin(), _kept.end(), result.path) == _kept.end()) {
+            _kept.push_back(result.path);
+            while (_maxFiles && _kept.size() > _maxFiles) {
+                unlink(_kept.front().c_str());
+                _kept.pop_front();
+            }
+        }
+        
+        pthread_mutex_lock(&_mutex);
+        _jobs.pop_front();
+        _results.push_back(result);
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+void TraceWriter::_scan() {
+    _scanned = true;
+    DIR* dir = opendir(_directory.c_str());
+    if (!dir) return;
+    
+    std::vector<std::string> names;
+    while (struct dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.compare(0, 6, "trace-") == 0 && name.length() > 11
+            && name.compare(name.length() - 5, 5, ".json") == 0)
+            names.push_back(name);
+    }
+    closedir(dir);
+    
+    std::sort(names.begin(), names.end());
+    for (size_t i = 0; i < names.size(); i++)
+        _kept.push_back(_directory + "/" + names[i]);
+}
+
+bool TraceWriter::_write(const std::string& path, const std::vector<TraceEvent>& events) {
+    std::string json;
+    TraceRing::renderEvents(events, json);
+    
+    std::ofstream output(path.c_str());
+    if (!output) return false;
+    output << json;
+    return output.good();
+}
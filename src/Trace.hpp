@@ -0,0 +1,98 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstddef>
+#include <pthread.h>
+
+#include "Metrics.hpp"
+
+struct TraceEvent {
+    const char* name;
+    unsigned long long start;
+    unsigned long long duration;
+};
+
+class TraceRing {
+private:
+    std::vector<TraceEvent> _events;
+    size_t _mask;
+    size_t _head;
+    
+public:
+    explicit TraceRing(size_t capacity);
+    
+    void record(const char* name, unsigned long long start, unsigned long long duration) {
+        TraceEvent& event = _events[_head++ & _mask];
+        event.name = name;
+        event.start = start;
+        event.duration = duration;
+    }
+    
+    void snapshot(std::vector<TraceEvent>& out, unsigned long long windowNs) const;
+    void render(std::string& out, unsigned long long windowNs) const;
+    size_t getRecorded() const { return _head; }
+    
+    static void renderEvents(const std::vector<TraceEvent>& events, std::string& out);
+};
+
+class TraceWriter {
+private:
+    struct Job {
+        std::string name;
+        std::vector<TraceEvent> events;
+    };
+    
+    struct Result {
+        std::string path;
+        bool written;
+    };
+    
+    pthread_t _thread;
+    pthread_mutex_t _mutex;
+    pthread_cond_t _cond;
+    bool _started;
+    bool _stopping;
+    bool _scanned;
+    std::string _directory;
+    size_t _maxFiles;
+    std::deque<Job> _jobs;
+    std::deque<Result> _results;
+    std::deque<std::string> _kept;
+    
+    TraceWriter(const TraceWriter&);
+    TraceWriter& operator=(const TraceWriter&);
+    
+    static void* _run(void* self);
+    void _workerLoop();
+    void _scan();
+    bool _write(const std::string& path, const std::vector<TraceEvent>& events);
+    
+public:
+    TraceWriter();
+    ~TraceWriter();
+    
+    void setDirectory(const std::string& directory) { _directory = directory; }
+    void setMaxFiles(size_t maxFiles) { _maxFiles = maxFiles; }
+    
+    bool submit(const std::string& name, const TraceRing& ring, unsigned long long windowNs);
+    bool takeResult(std::string& path, bool& written);
+};
+
+class TraceScope {
+private:
+    TraceRing& _ring;
+    const char* _name;
+    unsigned long long _start;
+    
+    TraceScope(const TraceScope&);
+    TraceScope& operator=(const TraceScope&);
+    
+public:
+    TraceScope(TraceRing& ring, const char* name) : _ring(ring), _name(name), _start(Metrics::nowNs()) {}
+    ~TraceScope() { _ring.record(_name, _start, Metrics::nowNs() - _start); }
+};
+
+#endif
@@ -0,0 +1,82 @@
+#include "WhowasHistory.hpp"
+#include "Client.hpp"
+#include "Mask.hpp"
+
+WhowasHistory::WhowasHistory(size_t capacity) : _head(0) {
+    resize(capacity);
+}
+
+void WhowasHistory::resize(size_t capacity) {
+    if (capacity == 0) capacity = 1;
+    
+    size_t buckets = 1;
+    while (buckets < capacity)
+        buckets <<= 1;
+    
+    WhowasEntry blank;
+    blank.signoff = 0;
+    blank.hash = 0;
+    blank.next = -1;
+    blank.used = false;
+    
+    _entries.assign(capacity, blank);
+    _buckets.assign(buckets, -1);
+    _head = 0;
+}
+
+unsigned long WhowasHistory::_hash(const std::string& foldedNick) {
+    unsigned long hash = 2166136261UL;
+    for (size_t i = 0; i < foldedNick.length(); i++) {
+        hash ^= static_cast<unsigned char>(foldedNick[i]);
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+void WhowasHistory::_unlink(int index) {
+    WhowasEntry& entry = _entries[index];
+    int* link = &_buckets[entry.hash & (_buckets.size() - 1)];
+    
+    while (*link != -1 && *link != index)
+        link = &_entries[*link].next;
+    if (*link == index)
+        *link = entry.next;
+    
+    entry.used = false;
+    entry.next = -1;
+}
+
+void WhowasHistory::record(Client* client) {
+    if (client->getNickname().empty()) return;
+    
+    int index = static_cast<int>(_head);
+    _head = (_head + 1) % _entries.size();
+    
+    WhowasEntry& entry = _entries[index];
+    if (entry.used)
+        _unlink(index);
+    
+    entry.nickname = InternedString(client->getNickname());
+    entry.username = client->getUsernameHandle();
+    entry.hostname = client->getHostnameHandle();
+    entry.realname = client->getRealnameHandle();
+    entry.signoff = time(NULL);
+    entry.hash = _hash(ircCasefold(client->getNickname()));
+    entry.used = true;
+    
+    int& bucket = _buckets[entry.hash & (_buckets.size() - 1)];
+    entry.next = bucket;
+    bucket = index;
+}
+
+void WhowasHistory::lookup(const std::string& nickname, size_t limit, std::vector<const WhowasEntry*>& results) const {
+    std::string folded = ircCasefold(nickname);
+    unsigned long hash = _hash(folded);
+    
+    for (int index = _buckets[hash & (_buckets.size() - 1)]; index != -1 && results.size() < limit;
+         index = _entries[index].next) {
+        const WhowasEntry& entry = _entries[index];
+        if (entry.hash == hash && ircCasefold(entry.nickname.str()) == folded)
+            results.push_back(&entry);
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef WHOWASHISTORY_HPP
+#define WHOWASHISTORY_HPP
+
+#include <string>
+#include <vector>
+#include <ctime>
+
+#include "StringPool.hpp"
+
+class Client;
+
+struct WhowasEntry {
+    InternedString nickname;
+    InternedString username;
+    InternedString hostname;
+    InternedString realname;
+    time_t signoff;
+    unsigned long hash;
+    int next;
+    bool used;
+};
+
+class WhowasHistory {
+private:
+    std::vector<WhowasEntry> _entries;
+    std::vector<int> _buckets;
+    size_t _head;
+    
+    static unsigned long _hash(const std::string& foldedNick);
+    void _unlink(int index);
+    
+public:
+    explicit WhowasHistory(size_t capacity);
+    
+    void resize(size_t capacity);
+    size_t getCapacity() const { return _entries.size(); }
+    
+    void record(Client* client);
+    void lookup(const std::string& nickname, size_t limit, std::vector<const WhowasEntry*>& results) const;
+};
+
+#endif
@@ -1,6 +1,7 @@
 #include "Server.hpp"
 #include <iostream>
 #include <cstdlib>
+#include <cstdio>
 #include <limits>
 #include <new>
 
@@ -129,6 +130,9 @@ int main(int argc, char* argv[]) {
     try {
         Server* server = NULL;
         
+        if (getenv("IRCSERV_HUGEPAGES"))
+            SlabPool::setHugePages(true);
+        
         try {
             server = new Server(port, password);
         } catch (const std::bad_alloc& e) {
@@ -137,6 +141,34 @@ int main(int argc, char* argv[]) {
             return 1;
         }
         
+        if (getenv("IRCSERV_OPER_PASSWORD"))
+            server->setOperPassword(getenv("IRCSERV_OPER_PASSWORD"));
+        if (getenv("IRCSERV_METRICS"))
+            server->setMetricsAddress(getenv("IRCSERV_METRICS"));
+        if (getenv("IRCSERV_LAG_THRESHOLD_MS"))
+            server->setLagThresholdMs(strtoul(getenv("IRCSERV_LAG_THRESHOLD_MS"), NULL, 10));
+        if (getenv("IRCSERV_TRACE_DIR"))
+            server->setTraceDirectory(getenv("IRCSERV_TRACE_DIR"));
+        if (getenv("IRCSERV_TRACE_KEEP"))
+            server->setTraceMaxFiles(strtoul(getenv("IRCSERV_TRACE_KEEP"), NULL, 10));
+        if (getenv("IRCSERV_MAX_CLIENTS"))
+            server->setMaxClients(strtoul(getenv("IRCSERV_MAX_CLIENTS"), NULL, 10));
+        if (getenv("IRCSERV_HISTORY_DIR"))
+            server->setHistoryDirectory(getenv("IRCSERV_HISTORY_DIR"));
+        if (getenv("IRCSERV_WHOWAS_CAPACITY"))
+            server->setWhowasCapacity(strtoul(getenv("IRCSERV_WHOWAS_CAPACITY"), NULL, 10));
+        unsigned int throttle, drop;
+        if (getenv("IRCSERV_SPAM_SOURCE") && sscanf(getenv("IRCSERV_SPAM_SOURCE"), "%u,%u", &throttle, &drop) == 2)
+            server->setSpamSourceThresholds(throttle, drop);
+        if (getenv("IRCSERV_SPAM_GLOBAL") && sscanf(getenv("IRCSERV_SPAM_GLOBAL"), "%u,%u", &throttle, &drop) == 2)
+            server->setSpamGlobalThresholds(throttle, drop);
+        if (getenv("IRCSERV_AUDIT_LOG"))
+            server->setAuditPath(getenv("IRCSERV_AUDIT_LOG"));
+        if (getenv("IRCSERV_AUDIT_FSYNC_MS"))
+            server->setAuditFsyncIntervalMs(strtol(getenv("IRCSERV_AUDIT_FSYNC_MS"), NULL, 10));
+        if (getenv("IRCSERV_AUDIT_ROTATE_BYTES"))
+            server->setAuditRotateBytes(strtoul(getenv("IRCSERV_AUDIT_ROTATE_BYTES"), NULL, 10));
+        
         std::cout << GREEN << "Server initialized successfully!" << RESET << std::endl;
         std::cout << "Ready to accept connections..." << std::endl;
         std::cout << std::endl;